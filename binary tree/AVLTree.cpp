@@ -0,0 +1,94 @@
+//#include "AVLTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                      Implementation of AVLTree                       ***/
+/****************************************************************************/
+
+template<class T, class Compare>
+bool AVLTree<T, Compare>::insert(const T& elem)
+{
+	vector<Node**> path;
+	Node **link = this->find_link(elem, &path);
+	if (*link)
+		return false;
+	*link = this->new_node(elem);
+	rebalance_path(path);
+	return true;
+}
+
+template<class T, class Compare>
+bool AVLTree<T, Compare>::erase(const T& elem)
+{
+	vector<Node**> path;
+	Node **link = this->find_link(elem, &path);
+	if (!*link)
+		return false;
+	this->remove_at(link, &path);
+	rebalance_path(path);
+	return true;
+}
+
+/*************/
+/* Balancing */
+/*************/
+
+template<class T, class Compare>
+void AVLTree<T, Compare>::rebalance_path(vector<Node**>& path)
+// Rebalances the nodes of 'path', listed from the root down, bottom-up.
+// A rotation only rearranges the nodes below its link, so the links
+// higher up in 'path' stay valid
+{
+	for (size_t k = path.size(); k-- > 0; )
+		rebalance(path[k]);
+}
+
+template<class T, class Compare>
+void AVLTree<T, Compare>::rebalance(Node **link)
+// PRE: the subtrees of '*link' are AVL trees whose heights differ by
+// two at most
+// Updates the stored height of '*link' and restores the balance with a
+// single or a double rotation
+{
+	Node *node = *link;
+	BTSubtreeStats::update(node);
+	int balance = this->balance_factor(node);
+	if (balance > 1) {
+		// left-heavy; a right-heavy left child needs a double rotation
+		if (this->balance_factor(node->left) < 0)
+			rotate_left(&node->left);
+		rotate_right(link);
+	}
+	else if (balance < -1) {
+		if (this->balance_factor(node->right) > 0)
+			rotate_right(&node->right);
+		rotate_left(link);
+	}
+}
+
+template<class T, class Compare>
+void AVLTree<T, Compare>::rotate_left(Node **link)
+// The right child 'b' of '*link' takes its place, with the old node as
+// its left child; the old left subtree of 'b' moves to the right of
+// the old node.  The inorder sequence does not change
+{
+	Node *a = *link, *b = a->right;
+	a->right = b->left;
+	b->left = a;
+	BTSubtreeStats::update(a);
+	BTSubtreeStats::update(b);
+	*link = b;
+}
+
+template<class T, class Compare>
+void AVLTree<T, Compare>::rotate_right(Node **link)
+// The mirror image of 'rotate_left'
+{
+	Node *b = *link, *a = b->left;
+	b->left = a->right;
+	a->right = b;
+	BTSubtreeStats::update(b);
+	BTSubtreeStats::update(a);
+	*link = a;
+}
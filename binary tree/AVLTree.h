@@ -0,0 +1,56 @@
+#ifndef __AVLTree_H
+#define __AVLTree_H
+
+#include "BinarySearchTree.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  AVLTree
+ *
+ ****************************************************************************/
+
+/* An 'AVLTree' is a binary search tree that keeps itself balanced: the
+ * heights of the two subtrees of any node differ by one at most (the
+ * 'balance_factor' of every node is -1, 0 or 1), so its height stays
+ * below 1.45 log2(n) whatever the order of the insertions, e.g. sorted
+ * keys.  The heights are stored in the nodes ('BTSubtreeStats'); after
+ * an insertion or a removal the nodes on the path are updated bottom-up
+ * and rotated where they are out of balance.
+ *
+ * 'insert' and 'erase' hide the unbalanced versions of the base class,
+ * which must not be called on an 'AVLTree' through a base reference.
+ */
+
+template <class T, class Compare = less<T> >
+class AVLTree : public BinarySearchTree<T, Compare, BTSubtreeStats> {
+ public:
+  typedef BTNode<T, BTSubtreeStats> Node;
+
+  /* Construction; the balanced bulk load of the base class already
+   * satisfies the AVL condition */
+  explicit AVLTree( const Compare& less_than = Compare() )
+    : BinarySearchTree<T, Compare, BTSubtreeStats>(less_than) {}
+  AVLTree( const T *sorted, int n_elements,
+           const Compare& less_than = Compare() )
+    : BinarySearchTree<T, Compare, BTSubtreeStats>(sorted, n_elements,
+                                                   less_than) {}
+
+  /* Mutators; they return false if 'elem' is already in the tree, or
+   * not in it, respectively */
+  bool insert( const T& elem );
+  bool erase( const T& elem );
+
+
+ protected:
+  void rebalance_path( vector<Node**>& path );
+  void rebalance( Node **link );
+  static void rotate_left( Node **link );
+  static void rotate_right( Node **link );
+};
+
+
+#include "AVLTree.cpp"
+
+#endif
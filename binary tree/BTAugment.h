@@ -0,0 +1,137 @@
+#ifndef __BTAugment_H
+#define __BTAugment_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+/*
+ * Augmentation policies
+ * ---------------------
+ *
+ * A 'BTNode' derives from an augmentation policy, which adds data to
+ * every node that is a function of the node and its subtrees.  A policy
+ * provides:
+ *
+ *   update(node)          recomputes the data of 'node' from its element
+ *                         and its children, whose data must be up to date
+ *   cached_size(node)     the number of nodes of the subtree 'node', or
+ *                         -1 if the policy does not keep it
+ *   cached_height(node)   the height of the subtree 'node', or -1
+ *   cached_hash(node)     a hash of the contents and the shape of the
+ *                         subtree 'node', if 'keeps_hash' is true
+ *   uses_elem             whether the data depends on the elements (and
+ *                         not just on the shape)
+ *
+ * The tree calls 'update' whenever it creates a node or changes the
+ * children of one, bottom-up, and for all the nodes after elements have
+ * been modified if 'uses_elem' is true, so the data stays consistent.
+ * The 'cached_' functions must accept a NULL node.
+ */
+
+
+/* 'BTNoAugment' adds nothing; a node then has no overhead at all */
+struct BTNoAugment {
+  static const bool keeps_hash = false;
+  static const bool uses_elem = false;
+
+  template<class Node> static void update( Node* ) {}
+  template<class Node> static int cached_size( const Node* ) { return -1; }
+  template<class Node> static int cached_height( const Node* ) { return -1; }
+  template<class Node> static size_t cached_hash( const Node* ) { return 0; }
+};
+
+
+/* 'BTSubtreeStats' keeps the size and the height of the subtree of every
+ * node, which makes 'node_count()' and 'height()' constant-time and
+ * allows order-statistic queries ('BinaryTree::select') */
+struct BTSubtreeStats {
+  int subtree_size;    // number of nodes in the subtree of this node
+  int subtree_height;  // height of the subtree of this node
+
+  static const bool keeps_hash = false;
+  static const bool uses_elem = false;
+
+  BTSubtreeStats() : subtree_size(1), subtree_height(1) {}
+
+  template<class Node>
+  static void update( Node *node ) {
+    int lh = cached_height(node->left), rh = cached_height(node->right);
+    node->subtree_size = 1 + cached_size(node->left)
+                           + cached_size(node->right);
+    node->subtree_height = 1 + (lh > rh ? lh : rh);
+  }
+  template<class Node>
+  static int cached_size( const Node *node )
+    { return (node ? node->subtree_size : 0); }
+  template<class Node>
+  static int cached_height( const Node *node )
+    { return (node ? node->subtree_height : 0); }
+  template<class Node> static size_t cached_hash( const Node* ) { return 0; }
+};
+
+
+/* 'BTSubtreeHash' keeps a Merkle-style hash in every node, computed
+ * from the hash of the element and the hashes of the two subtrees (so
+ * it depends on the shape as well as on the elements).  Trees whose
+ * root hashes differ are certainly different; equal hashes make equal
+ * trees very likely, but not certain.  The element type needs a
+ * 'std::hash' specialization */
+struct BTSubtreeHash {
+  size_t subtree_hash;  // hash of the subtree of this node
+
+  static const bool keeps_hash = true;
+  static const bool uses_elem = true;
+
+  BTSubtreeHash() : subtree_hash(0) {}
+
+  template<class Node>
+  static void update( Node *node ) {
+    node->subtree_hash = node_hash(node->elem, cached_hash(node->left),
+                                   cached_hash(node->right));
+  }
+  template<class Node> static int cached_size( const Node* ) { return -1; }
+  template<class Node> static int cached_height( const Node* ) { return -1; }
+  template<class Node>
+  static size_t cached_hash( const Node *node )
+    { return (node ? node->subtree_hash : empty_hash()); }
+
+  /* The hash of an empty subtree, and of a node given the hashes of its
+   * subtrees; the mixing is order-dependent, so swapping the subtrees
+   * changes the hash */
+  static size_t empty_hash() { return size_t(0x2545f4914f6cdd1dULL); }
+  template<class T>
+  static size_t node_hash( const T& elem, size_t left, size_t right )
+    { return combine(combine(hash<T>()(elem), left), right); }
+  static size_t combine( size_t h, size_t v ) {
+    h ^= v + size_t(0x9e3779b97f4a7c15ULL) + (h << 6) + (h >> 2);
+    h ^= h >> 29;
+    return h * size_t(0xbf58476d1ce4e5b9ULL);
+  }
+};
+
+
+/* 'BTRefCount' is not an augmentation in the sense above: it gives every
+ * node a reference count, so that a node can be shared by several trees
+ * (see "PersistentBinaryTree.h").  A new node starts with a count of 1,
+ * for the one link that will point to it.  The count is atomic, so trees
+ * sharing nodes may be used from different threads. */
+struct BTRefCount {
+  atomic<int> ref_count;  // number of links (roots or children) to this node
+
+  static const bool keeps_hash = false;
+  static const bool uses_elem = false;
+
+  BTRefCount() : ref_count(1) {}
+  BTRefCount( const BTRefCount& ) : ref_count(1) {}
+  BTRefCount& operator=( const BTRefCount& ) { return *this; }
+
+  template<class Node> static void update( Node* ) {}
+  template<class Node> static int cached_size( const Node* ) { return -1; }
+  template<class Node> static int cached_height( const Node* ) { return -1; }
+  template<class Node> static size_t cached_hash( const Node* ) { return 0; }
+};
+
+#endif
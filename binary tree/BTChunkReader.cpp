@@ -0,0 +1,53 @@
+//#include "BTChunkReader.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of BTChunkReader                    ***/
+/****************************************************************************/
+
+inline bool BTChunkReader::read(void *dest, size_t n)
+// A record may straddle two chunks, so it is copied piece by piece
+{
+	char *out = (char*) dest;
+	size_t copied = 0;
+	while (copied < n) {
+		if (pos == end && !refill()) {
+			if (copied > 0)
+				truncated = true;
+			return false;
+		}
+		size_t k = min(n - copied, end - pos);
+		memcpy(out + copied, &buf[pos], k);
+		pos += k;
+		copied += k;
+	}
+	return true;
+}
+
+inline bool BTChunkReader::refill()
+{
+	pos = end = 0;
+	if (!in)
+		return false;
+	in.read(&buf[0], streamsize(buf.size()));
+	end = size_t(in.gcount());
+	return end > 0;
+}
+
+inline bool BTChunkReader::give_back()
+// The end of the stream may have been reached while reading ahead; the
+// state is cleared for the seek, and put back if the seek fails
+{
+	if (pos == end)
+		return true;
+	ios::iostate state = in.rdstate();
+	in.clear();
+	in.seekg(-streamoff(end - pos), ios::cur);
+	if (in.fail()) {
+		in.clear(state);
+		return false;
+	}
+	pos = end;
+	return true;
+}
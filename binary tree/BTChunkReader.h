@@ -0,0 +1,62 @@
+#ifndef __BTChunkReader_H
+#define __BTChunkReader_H
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BTChunkReader
+ *
+ ****************************************************************************/
+
+/* A 'BTChunkReader' reads binary records from an 'istream' through a
+ * buffer of a fixed size, so that a stream of any length is consumed
+ * with a bounded amount of memory (see 'BinaryTree::read_complete' and
+ * 'BinaryTree::read_preorder').  A file descriptor can be read the same
+ * way once it is wrapped in a stream buffer.
+ *
+ * NOTE:  The reader reads ahead by up to a chunk, so the stream moves
+ *        past the last record read.  'give_back' moves it back, but only
+ *        a seekable stream can do that; on a pipe or a socket, the bytes
+ *        read ahead are lost.
+ */
+
+class BTChunkReader {
+ public:
+  BTChunkReader( istream& in, size_t chunk_bytes = 1 << 16 )
+    : in(in), buf(chunk_bytes > 0 ? chunk_bytes : 1), pos(0), end(0),
+      truncated(false) {}
+
+  /* Copies the next 'n' bytes of the stream to 'dest'; returns false
+   * (and copies nothing useful) if the stream ends first */
+  bool read( void *dest, size_t n );
+  template<class T> bool read( T& x ) { return read(&x, sizeof(x)); }
+
+  /* Whether the stream ended in the middle of a record; at a record
+   * boundary it is a normal end */
+  bool is_truncated() const { return truncated; }
+
+  /* Moves the stream back to just after the last record read, so that
+   * the bytes read ahead can be read again by the caller; returns false
+   * if the stream cannot seek */
+  bool give_back();
+
+ protected:
+  istream& in;
+  vector<char> buf;  // the current chunk
+  size_t pos;        // next unread byte of 'buf'
+  size_t end;        // number of valid bytes in 'buf'
+  bool truncated;
+
+  bool refill();
+};
+
+
+#include "BTChunkReader.cpp"
+
+#endif
@@ -0,0 +1,157 @@
+//#include "BTFrozenTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of BTFrozenTree                     ***/
+/****************************************************************************/
+
+template<class T, class Compare>
+template<class A>
+BTFrozenTree<T, Compare>::BTFrozenTree(const BinaryTree<T, A>& src,
+	BTLayout layout, const Compare& less_than)
+	: tree_height(0), less_than(less_than)
+// The nodes are first numbered in level order, which gives the children
+// of each node as indices without any lookup: in level order, the
+// children of the nodes come in the same order as the nodes themselves.
+// The van Emde Boas order is then computed on those indices
+{
+	vector<T> elems;
+	vector<pair<int, int> > children;
+	vector<int> depth(1, 1);
+	int next = 1;
+	for (typename BinaryTree<T, A>::levelorder_iterator
+	     it = src.levelorder_begin(); it != src.levelorder_end(); ++it) {
+		int k = int(elems.size());
+		elems.push_back(*it);
+		int d = depth[k];
+		tree_height = max(tree_height, d);
+		pair<int, int> c(-1, -1);
+		if (it.node()->left)
+			c.first = next++;
+		if (it.node()->right)
+			c.second = next++;
+		depth.resize(next, d + 1);
+		children.push_back(c);
+	}
+
+	int n = int(elems.size());
+	vector<int> order;  // the level-order index of every new position
+	if (layout == BTLayoutVEB && n > 0) {
+		order.reserve(n);
+		veb_order(children, 0, tree_height, order);
+	}
+	else {
+		order.resize(n);
+		for (int k = 0; k < n; k++)
+			order[k] = k;
+	}
+
+	vector<int> position(n);
+	for (int k = 0; k < n; k++)
+		position[order[k]] = k;
+	nodes.resize(n);
+	for (int k = 0; k < n; k++) {
+		const pair<int, int>& c = children[order[k]];
+		nodes[k].elem = elems[order[k]];
+		nodes[k].left = (c.first < 0 ? -1 : position[c.first]);
+		nodes[k].right = (c.second < 0 ? -1 : position[c.second]);
+	}
+}
+
+template<class T, class Compare>
+void BTFrozenTree<T, Compare>::veb_order(
+	const vector<pair<int, int> >& children, int root, int h,
+	vector<int>& order)
+// Appends to 'order' the nodes of the subtree of 'root' that are less
+// than 'h' levels below it, in van Emde Boas order: the top 'h/2'
+// levels, then the subtrees rooted at the level below those, from left
+// to right, each of them 'h - h/2' levels high.  The recursion depth is
+// O(log h); the roots of the bottom subtrees are found with an explicit
+// stack
+{
+	if (h == 1) {
+		order.push_back(root);
+		return;
+	}
+	int top = h / 2;
+	veb_order(children, root, top, order);
+
+	vector<int> bottoms;
+	vector<pair<int, int> > stack(1, make_pair(root, 0));
+	while (!stack.empty()) {
+		int node = stack.back().first, d = stack.back().second;
+		stack.pop_back();
+		if (d == top) {
+			bottoms.push_back(node);
+			continue;
+		}
+		if (children[node].second >= 0)
+			stack.push_back(make_pair(children[node].second, d + 1));
+		if (children[node].first >= 0)
+			stack.push_back(make_pair(children[node].first, d + 1));
+	}
+	for (size_t k = 0; k < bottoms.size(); k++)
+		veb_order(children, bottoms[k], h - top, order);
+}
+
+/*************/
+/* Searching */
+/*************/
+
+template<class T, class Compare>
+const T* BTFrozenTree<T, Compare>::find(const T& elem) const
+{
+	int i = (nodes.empty() ? -1 : 0);
+	while (i >= 0) {
+		const Node& node = nodes[i];
+		if (less_than(elem, node.elem))
+			i = node.left;
+		else if (less_than(node.elem, elem))
+			i = node.right;
+		else
+			return &node.elem;
+	}
+	return NULL;
+}
+
+template<class T, class Compare>
+const T* BTFrozenTree<T, Compare>::lower_bound(const T& elem) const
+{
+	int i = (nodes.empty() ? -1 : 0);
+	const T *bound = NULL;
+	while (i >= 0) {
+		const Node& node = nodes[i];
+		if (less_than(node.elem, elem))
+			i = node.right;
+		else {
+			bound = &node.elem;
+			i = node.left;
+		}
+	}
+	return bound;
+}
+
+/*************/
+/* Traversal */
+/*************/
+
+template<class T, class Compare>
+template<class F>
+void BTFrozenTree<T, Compare>::inorder(F&& f) const
+{
+	vector<int> stack;
+	int i = (nodes.empty() ? -1 : 0);
+	while (i >= 0 || !stack.empty()) {
+		if (i >= 0) {
+			stack.push_back(i);
+			i = nodes[i].left;
+		}
+		else {
+			i = stack.back();
+			stack.pop_back();
+			f(nodes[i].elem);
+			i = nodes[i].right;
+		}
+	}
+}
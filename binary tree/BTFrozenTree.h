@@ -0,0 +1,87 @@
+#ifndef __BTFrozenTree_H
+#define __BTFrozenTree_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "BinaryTree.h"
+
+using namespace std;
+
+/* The orders in which a 'BTFrozenTree' can place its nodes */
+enum BTLayout {
+  BTLayoutBFS,  // level by level, as in the complete-tree array
+  BTLayoutVEB   // van Emde Boas: recursively, the top half of the levels,
+                // then each of the subtrees below it
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTFrozenTree
+ *
+ ****************************************************************************/
+
+/* A 'BTFrozenTree' is a read-only copy of a search tree ("frozen"), with
+ * all the nodes in one array and the children given by their indices.
+ * Where the nodes of a 'BinaryTree' lie in memory is up to the
+ * allocator, so a search misses the cache at almost every level; here
+ * the layout is chosen instead:
+ *
+ *   - 'BTLayoutBFS' keeps the first levels together, but below them
+ *     every step of a search lands on another cache line;
+ *   - 'BTLayoutVEB' splits the tree at half its height and stores the
+ *     top part, then every bottom subtree, each of them laid out the
+ *     same way recursively.  Any path then crosses O(log_B n) blocks of
+ *     B nodes, for every block size B at once (cache lines, pages),
+ *     without knowing B.
+ *
+ * The tree must be ordered by 'Compare' for the searches to work; any
+ * shape is accepted.
+ */
+
+template <class T, class Compare = less<T> >
+class BTFrozenTree {
+ public:
+
+  /* Construction */
+  BTFrozenTree() : tree_height(0), less_than() {}
+  template<class A>
+  BTFrozenTree( const BinaryTree<T, A>& src, BTLayout layout = BTLayoutVEB,
+                const Compare& less_than = Compare() );
+
+  /* Access and Tests */
+  bool is_empty() const      { return nodes.empty(); }
+  int height() const         { return tree_height; }
+  int node_count() const     { return int(nodes.size()); }
+
+  /* Searching: the element equal to 'elem', or the least element that
+   * is not less than 'elem'; NULL if there is none */
+  const T *find( const T& elem ) const;
+  const T *lower_bound( const T& elem ) const;
+  bool contains( const T& elem ) const { return find(elem) != NULL; }
+
+  /* Traversal, in increasing order */
+  template<class F> void inorder( F&& f ) const;
+
+
+ protected:
+  struct Node {
+    T elem;
+    int32_t left;   // index of the left child in 'nodes' (-1 if none)
+    int32_t right;  // index of the right child (-1 if none)
+  };
+  vector<Node> nodes;  // the root is 'nodes[0]'
+  int tree_height;
+  Compare less_than;
+
+  static void veb_order( const vector<pair<int, int> >& children, int root,
+                         int h, vector<int>& order );
+};
+
+
+#include "BTFrozenTree.cpp"
+
+#endif
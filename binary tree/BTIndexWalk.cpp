@@ -0,0 +1,233 @@
+//#include "BTIndexWalk.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                    Implementation of BTIndexWalk                     ***/
+/****************************************************************************/
+
+/*************/
+/* Traversal */
+/*************/
+
+template<class Tree, class F>
+void BTIndexWalk::preorder(const Tree& tree, F& f, Stack& stack)
+{
+	// the stack holds the right subtrees still to be visited
+	Index node = tree.root_node();
+	stack.clear();
+	while (node || !stack.empty()) {
+		if (!node) {
+			node = stack.back();
+			stack.pop_back();
+		}
+		f(node);
+		if (tree.right(node))
+			stack.push_back(tree.right(node));
+		node = tree.left(node);
+	}
+}
+
+template<class Tree, class F>
+void BTIndexWalk::inorder(const Tree& tree, F& f, Stack& stack)
+{
+	// the stack holds the nodes whose left subtree is being visited
+	Index node = tree.root_node();
+	stack.clear();
+	while (node || !stack.empty()) {
+		while (node) {
+			stack.push_back(node);
+			node = tree.left(node);
+		}
+		node = stack.back();
+		stack.pop_back();
+		f(node);
+		node = tree.right(node);
+	}
+}
+
+template<class Tree, class F>
+void BTIndexWalk::postorder(const Tree& tree, F& f, Stack& stack)
+{
+	// the stack holds the path down to the current node; 'last' is the
+	// node visited most recently, which tells whether the right subtree
+	// of the top node has been done yet
+	Index node = tree.root_node(), last = 0;
+	stack.clear();
+	while (node || !stack.empty()) {
+		if (node) {
+			stack.push_back(node);
+			node = tree.left(node);
+		}
+		else {
+			Index top = stack.back();
+			if (tree.right(top) && tree.right(top) != last)
+				node = tree.right(top);
+			else {
+				f(top);
+				last = top;
+				stack.pop_back();
+			}
+		}
+	}
+}
+
+/********************/
+/* Access and Tests */
+/********************/
+
+template<class Tree>
+int BTIndexWalk::height(const Tree& tree)
+// The stack holds the pending nodes with their depth
+{
+	int h = 0;
+	vector<pair<Index, int> > stack;
+	if (tree.root_node())
+		stack.push_back(make_pair(tree.root_node(), 1));
+	while (!stack.empty()) {
+		Index node = stack.back().first;
+		int depth = stack.back().second;
+		stack.pop_back();
+		if (depth > h)
+			h = depth;
+		if (tree.left(node))
+			stack.push_back(make_pair(tree.left(node), depth + 1));
+		if (tree.right(node))
+			stack.push_back(make_pair(tree.right(node), depth + 1));
+	}
+	return h;
+}
+
+template<class Tree>
+int BTIndexWalk::node_count(const Tree& tree)
+{
+	int n = 0;
+	Stack stack;
+	auto count = [&n](Index) { n++; };
+	preorder(tree, count, stack);
+	return n;
+}
+
+template<class Tree>
+int BTIndexWalk::leaf_count(const Tree& tree)
+{
+	int n = 0;
+	Stack stack;
+	auto count = [&n, &tree](Index k) { n += tree.is_leaf(k); };
+	preorder(tree, count, stack);
+	return n;
+}
+
+template<class Tree>
+size_t BTIndexWalk::hash(const Tree& tree)
+// The same hash as 'BinaryTree::hash'.  The postorder walk keeps the
+// hashes of the finished subtrees on a stack of their own; a node takes
+// the ones on top, which belong to its children (the right one last)
+{
+	vector<size_t> hashes;
+	Stack stack;
+	auto combine = [&hashes, &tree](Index k) {
+		size_t right = BTSubtreeHash::empty_hash();
+		size_t left = BTSubtreeHash::empty_hash();
+		if (tree.right(k)) {
+			right = hashes.back();
+			hashes.pop_back();
+		}
+		if (tree.left(k)) {
+			left = hashes.back();
+			hashes.pop_back();
+		}
+		hashes.push_back(BTSubtreeHash::node_hash(tree.elem(k), left, right));
+	};
+	postorder(tree, combine, stack);
+	return (hashes.empty() ? BTSubtreeHash::empty_hash() : hashes.back());
+}
+
+template<class Tree>
+bool BTIndexWalk::equal(const Tree& a, const Tree& b)
+// Walks both trees in step; the indices of equal trees may differ
+{
+	vector<pair<Index, Index> > stack(1, make_pair(a.root_node(),
+		b.root_node()));
+	while (!stack.empty()) {
+		Index i = stack.back().first, j = stack.back().second;
+		stack.pop_back();
+		if (!i || !j) {
+			if (i || j)
+				return false;
+			continue;
+		}
+		if (!(a.elem(i) == b.elem(j)))
+			return false;
+		stack.push_back(make_pair(a.left(i), b.left(j)));
+		stack.push_back(make_pair(a.right(i), b.right(j)));
+	}
+	return true;
+}
+
+/************************/
+/* Conversion to Arrays */
+/************************/
+
+template<class Tree, class T>
+int BTIndexWalk::to_flat_array(const Tree& tree, T *elements, int max)
+// PRE: 'tree' is a complete binary tree
+// Same as 'BinaryTree::to_flat_array'; the complete-tree indices are
+// carried along with the nodes
+{
+	int max_index = 0;
+	vector<pair<Index, int> > stack;
+	if (tree.root_node())
+		stack.push_back(make_pair(tree.root_node(), 1));
+	while (!stack.empty()) {
+		Index node = stack.back().first;
+		int index = stack.back().second;
+		stack.pop_back();
+		if (index > max_index)
+			max_index = index;
+		if (index <= max)
+			elements[index] = tree.elem(node);
+		if (tree.left(node))
+			stack.push_back(make_pair(tree.left(node), 2 * index));
+		if (tree.right(node))
+			stack.push_back(make_pair(tree.right(node), 2 * index + 1));
+	}
+	return max_index;
+}
+
+template<class Tree, class T>
+int BTIndexWalk::to_sparse_array(const Tree& tree, vector<bool>& present,
+	vector<T>& elements)
+// Same as 'BinaryTree::to_sparse_array', with a queue of indices in
+// place of the level-order iterator
+{
+	present.clear();
+	elements.clear();
+	present.push_back(tree.root_node() != 0);
+	Stack queue;
+	if (tree.root_node())
+		queue.push_back(tree.root_node());
+	for (size_t head = 0; head < queue.size(); head++) {
+		Index node = queue[head];
+		elements.push_back(tree.elem(node));
+		present.push_back(tree.left(node) != 0);
+		present.push_back(tree.right(node) != 0);
+		if (tree.left(node))
+			queue.push_back(tree.left(node));
+		if (tree.right(node))
+			queue.push_back(tree.right(node));
+	}
+	return int(elements.size());
+}
+
+/****************/
+/* Input/Output */
+/****************/
+
+template<class Tree>
+void BTIndexWalk::write(ostream& out, const Tree& tree)
+{
+	Stack stack;
+	auto put = [&out, &tree](Index k) { out << tree.elem(k) << " "; };
+	inorder(tree, put, stack);
+}
@@ -0,0 +1,71 @@
+#ifndef __BTIndexWalk_H
+#define __BTIndexWalk_H
+
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "BTAugment.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BTIndexWalk
+ *
+ ****************************************************************************/
+
+/* 'BTIndexWalk' holds the walks shared by the trees whose nodes are
+ * numbered instead of linked by pointers ('CompactBinaryTree' and
+ * 'SoABinaryTree').  A node is a 32-bit index, with 0 for no node, and
+ * a tree is any 'Tree' with
+ *
+ *   root_node()  the root (0 if the tree is empty),
+ *   left(k)      the children of node 'k' (0 if none),
+ *   right(k)
+ *   elem(k)      the element of node 'k'
+ *   is_leaf(k)   whether node 'k' has no children
+ *
+ * The walks are iterative, like those of 'BinaryTree', and visit the
+ * nodes in the same order; the traversals pass the index of each node
+ * to 'f', so that the tree can hand out its elements as it likes.
+ */
+
+class BTIndexWalk {
+ public:
+  typedef uint32_t Index;
+  typedef vector<Index> Stack;
+
+  /* Traversals: 'f(k)' for every node 'k'; 'stack' is cleared first */
+  template<class Tree, class F>
+  static void preorder( const Tree& tree, F& f, Stack& stack );
+  template<class Tree, class F>
+  static void inorder( const Tree& tree, F& f, Stack& stack );
+  template<class Tree, class F>
+  static void postorder( const Tree& tree, F& f, Stack& stack );
+
+  /* The queries and conversions of 'BinaryTree' of the same names */
+  template<class Tree> static int height( const Tree& tree );
+  template<class Tree> static int node_count( const Tree& tree );
+  template<class Tree> static int leaf_count( const Tree& tree );
+  template<class Tree> static size_t hash( const Tree& tree );
+  template<class Tree, class T>
+  static int to_flat_array( const Tree& tree, T *elements, int max );
+  template<class Tree, class T>
+  static int to_sparse_array( const Tree& tree, vector<bool>& present,
+                              vector<T>& elements );
+
+  /* Whether 'a' and 'b' have the same shape and elements */
+  template<class Tree>
+  static bool equal( const Tree& a, const Tree& b );
+
+  /* Writes the elements by way of an inorder traversal */
+  template<class Tree>
+  static void write( ostream& out, const Tree& tree );
+};
+
+
+#include "BTIndexWalk.cpp"
+
+#endif
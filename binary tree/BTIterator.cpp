@@ -0,0 +1,137 @@
+//#include "BTIterator.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                    Implementation of BTIterator                      ***/
+/****************************************************************************/
+
+/*
+ * What the stack holds depends on the order:
+ *
+ *   preorder:   the right children still to be visited
+ *   inorder:    the ancestors whose left subtree is being visited
+ *   postorder:  all the ancestors of the current node
+ *
+ * In each case there is at most one entry per level of the tree.
+ */
+
+template<class Node, BTTraversalOrder Order>
+BTIterator<Node, Order>::BTIterator(Node *root)
+{
+	cur = NULL;
+	if (!root)
+		return;
+	if (Order == BTPreorder)
+		cur = root;
+	else if (Order == BTInorder) {
+		push_left_path(root);
+		cur = stack.top();
+		stack.pop();
+	}
+	else
+		descend_to_first_postorder(root);
+}
+
+template<class Node, BTTraversalOrder Order>
+BTIterator<Node, Order>& BTIterator<Node, Order>::operator++()
+{
+	if (Order == BTPreorder) {
+		if (cur->right)
+			stack.push(cur->right);
+		if (cur->left)
+			cur = cur->left;
+		else if (stack.empty())
+			cur = NULL;
+		else {
+			cur = stack.top();
+			stack.pop();
+		}
+	}
+	else if (Order == BTInorder) {
+		push_left_path(cur->right);
+		if (stack.empty())
+			cur = NULL;
+		else {
+			cur = stack.top();
+			stack.pop();
+		}
+	}
+	else {
+		// after a left child comes the right subtree of the parent (if
+		// any), and after that the parent itself
+		if (stack.empty()) {
+			cur = NULL;
+			return *this;
+		}
+		Node *parent = stack.top();
+		if (cur == parent->left && parent->right)
+			descend_to_first_postorder(parent->right);
+		else {
+			cur = parent;
+			stack.pop();
+		}
+	}
+	return *this;
+}
+
+template<class Node, BTTraversalOrder Order>
+void BTIterator<Node, Order>::push_left_path(Node *node)
+{
+	for (; node; node = node->left)
+		stack.push(node);
+}
+
+template<class Node, BTTraversalOrder Order>
+void BTIterator<Node, Order>::descend_to_first_postorder(Node *node)
+// Makes the first node of the subtree 'node' in postorder current,
+// i.e., the leaf reached by going left whenever possible
+{
+	for (;;) {
+		if (node->left) {
+			stack.push(node);
+			node = node->left;
+		}
+		else if (node->right) {
+			stack.push(node);
+			node = node->right;
+		}
+		else
+			break;
+	}
+	cur = node;
+}
+
+
+/****************************************************************************/
+/***                  Implementation of BTLevelIterator                   ***/
+/****************************************************************************/
+
+template<class Node>
+BTLevelIterator<Node>::BTLevelIterator(Node *root)
+{
+	cur = root;
+	head = 0;
+}
+
+template<class Node>
+BTLevelIterator<Node>& BTLevelIterator<Node>::operator++()
+{
+	if (cur->left)
+		queue.push_back(cur->left);
+	if (cur->right)
+		queue.push_back(cur->right);
+
+	if (head == queue.size()) {
+		cur = NULL;
+		return *this;
+	}
+	cur = queue[head++];
+
+	// drop the consumed front of the queue once it is the larger part
+	if (head > 64 && 2 * head > queue.size()) {
+		queue.erase(queue.begin(), queue.begin() + head);
+		head = 0;
+	}
+	return *this;
+}
@@ -0,0 +1,142 @@
+#ifndef __BTIterator_H
+#define __BTIterator_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+
+/* The depth-first orders an iterator can walk a tree in */
+enum BTTraversalOrder { BTPreorder, BTInorder, BTPostorder };
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTSmallStack
+ *
+ ****************************************************************************/
+
+/* A 'BTSmallStack' is a stack of node pointers that keeps its first 'N'
+ * entries inside the object itself and only uses the heap beyond that.
+ * An iterator over a tree of height up to 'N' thus never allocates.
+ */
+
+template <class P, int N = 32>
+class BTSmallStack {
+ public:
+  BTSmallStack() : n(0) {}
+
+  bool empty() const { return n == 0; }
+  void push( P p )
+    { if (n < N) inline_buf[n] = p; else spill.push_back(p); n++; }
+  P top() const
+    { return (n <= N ? inline_buf[n - 1] : spill.back()); }
+  void pop()
+    { n--; if (n >= N) spill.pop_back(); }
+
+ private:
+  P inline_buf[N];  // the bottom 'N' entries
+  vector<P> spill;  // the entries above the bottom 'N'
+  int n;            // total number of entries
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTIterator
+ *
+ ****************************************************************************/
+
+/* A 'BTIterator' walks a binary tree lazily in one of the depth-first
+ * orders, as a standard forward iterator over the (constant) elements.
+ * It keeps the path of pending nodes in a 'BTSmallStack', so copying and
+ * advancing it is cheap, and a search that stops early (e.g. with
+ * 'find_if') only pays for the nodes it actually looked at.
+ *
+ * 'Node' is the node type of the tree ('BTNode<T, A>').  An iterator is
+ * invalidated by any change to the structure of its tree.
+ */
+
+template <class Node, BTTraversalOrder Order>
+class BTIterator {
+ public:
+  typedef forward_iterator_tag      iterator_category;
+  typedef typename Node::value_type value_type;
+  typedef ptrdiff_t                 difference_type;
+  typedef const value_type*         pointer;
+  typedef const value_type&         reference;
+
+  /* Construction: an iterator at the first node of the subtree 'root',
+   * or the end iterator when 'root' is NULL */
+  BTIterator( Node *root = NULL );
+
+  /* Access */
+  reference operator*() const  { return cur->elem; }
+  pointer operator->() const   { return &cur->elem; }
+  Node *node() const           { return cur; }
+
+  /* Advancing */
+  BTIterator& operator++();
+  BTIterator operator++( int ) { BTIterator old(*this); ++(*this); return old; }
+
+  /* Comparison */
+  bool operator==( const BTIterator& src ) const { return cur == src.cur; }
+  bool operator!=( const BTIterator& src ) const { return cur != src.cur; }
+
+ private:
+  Node *cur;                  // current node (NULL at the end)
+  BTSmallStack<Node*> stack;  // pending nodes, depending on 'Order'
+
+  void push_left_path( Node *node );
+  void descend_to_first_postorder( Node *node );
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTLevelIterator
+ *
+ ****************************************************************************/
+
+/* A 'BTLevelIterator' walks a binary tree in level order (breadth first,
+ * left to right), which for a complete tree is the complete-tree order.
+ * It needs a queue as wide as the widest level rather than a stack.
+ */
+
+template <class Node>
+class BTLevelIterator {
+ public:
+  typedef forward_iterator_tag      iterator_category;
+  typedef typename Node::value_type value_type;
+  typedef ptrdiff_t                 difference_type;
+  typedef const value_type*         pointer;
+  typedef const value_type&         reference;
+
+  /* Construction */
+  BTLevelIterator( Node *root = NULL );
+
+  /* Access */
+  reference operator*() const  { return cur->elem; }
+  pointer operator->() const   { return &cur->elem; }
+  Node *node() const           { return cur; }
+
+  /* Advancing */
+  BTLevelIterator& operator++();
+  BTLevelIterator operator++( int )
+    { BTLevelIterator old(*this); ++(*this); return old; }
+
+  /* Comparison */
+  bool operator==( const BTLevelIterator& src ) const { return cur == src.cur; }
+  bool operator!=( const BTLevelIterator& src ) const { return cur != src.cur; }
+
+ private:
+  Node *cur;            // current node (NULL at the end)
+  vector<Node*> queue;  // nodes still to be visited, from 'head' on
+  size_t head;
+};
+
+
+#include "BTIterator.cpp"
+
+#endif
@@ -0,0 +1,264 @@
+//#include "BTKaryTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                    Search kernels of BTKaryTree                      ***/
+/****************************************************************************/
+
+/*
+ * Each kernel walks down from node 0 and returns the key slot of the
+ * lower bound of 'key', or NULL if no slot holds a key that is not less.
+ * The keys of a node are sorted, so the number of them that are less
+ * than 'key' is both the slot of the lower bound within the node (if it
+ * is below 16) and the child to go on with.
+ *
+ * The SIMD kernels are compiled for their instruction set whatever the
+ * compiler options (GCC and Clang need a target attribute for that,
+ * MSVC does not), and are only called once 'bt_simd_supported' has
+ * found that set.  Each has its own loop, so that the comparisons are
+ * inlined into code compiled for the same set.
+ */
+
+#if defined(BT_X86) && !defined(_MSC_VER)
+#define BT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BT_TARGET(isa)
+#endif
+
+inline BTSimdLevel bt_simd_supported()
+{
+#if defined(BT_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] >> 26) & 1;
+	// AVX2 also needs the operating system to save the YMM registers
+	bool avx_os = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1)
+		&& (_xgetbv(0) & 6) == 6;
+	bool avx2 = false;
+	if (max_leaf >= 7 && avx_os) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] >> 5) & 1;
+	}
+	return (avx2 ? BTSimdAVX2 : sse2 ? BTSimdSSE2 : BTSimdScalar);
+#elif defined(BT_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return BTSimdAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return BTSimdSSE2;
+	return BTSimdScalar;
+#else
+	return BTSimdScalar;
+#endif
+}
+
+inline const int32_t *bt_kary_search_scalar(const int32_t *nodes,
+	size_t n_nodes, int32_t key)
+{
+	const int32_t *bound = NULL;
+	for (size_t k = 0; k < n_nodes; ) {
+		const int32_t *node = nodes + 16 * k;
+		int rank = 0;
+		for (int i = 0; i < 16; i++)
+			rank += (node[i] < key);
+		if (rank < 16)
+			bound = node + rank;
+		k = 17 * k + rank + 1;
+	}
+	return bound;
+}
+
+#ifdef BT_X86
+
+BT_TARGET("sse2")
+inline const int32_t *bt_kary_search_sse2(const int32_t *nodes,
+	size_t n_nodes, int32_t key)
+// The four comparison masks are packed into one byte per key, so that
+// one 'movemask' gives a bit per key; the bits are counted by halves
+{
+	const int32_t *bound = NULL;
+	__m128i x = _mm_set1_epi32(key);
+	for (size_t k = 0; k < n_nodes; ) {
+		const int32_t *node = nodes + 16 * k;
+		const __m128i *v = (const __m128i*) node;
+		__m128i lo = _mm_packs_epi32(_mm_cmpgt_epi32(x, _mm_load_si128(v)),
+			_mm_cmpgt_epi32(x, _mm_load_si128(v + 1)));
+		__m128i hi = _mm_packs_epi32(_mm_cmpgt_epi32(x, _mm_load_si128(v + 2)),
+			_mm_cmpgt_epi32(x, _mm_load_si128(v + 3)));
+		unsigned m = unsigned(_mm_movemask_epi8(_mm_packs_epi16(lo, hi)));
+		m = m - ((m >> 1) & 0x5555);
+		m = (m & 0x3333) + ((m >> 2) & 0x3333);
+		m = (m + (m >> 4)) & 0x0f0f;
+		int rank = int((m + (m >> 8)) & 0x1f);
+		if (rank < 16)
+			bound = node + rank;
+		k = 17 * k + rank + 1;
+	}
+	return bound;
+}
+
+BT_TARGET("avx2,popcnt")
+inline const int32_t *bt_kary_search_avx2(const int32_t *nodes,
+	size_t n_nodes, int32_t key)
+{
+	const int32_t *bound = NULL;
+	__m256i x = _mm256_set1_epi32(key);
+	for (size_t k = 0; k < n_nodes; ) {
+		const int32_t *node = nodes + 16 * k;
+		const __m256i *v = (const __m256i*) node;
+		__m256i lo = _mm256_cmpgt_epi32(x, _mm256_load_si256(v));
+		__m256i hi = _mm256_cmpgt_epi32(x, _mm256_load_si256(v + 1));
+		unsigned m = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(lo)))
+			| unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(hi))) << 8;
+		int rank = int(_mm_popcnt_u32(m));
+		if (rank < 16)
+			bound = node + rank;
+		k = 17 * k + rank + 1;
+	}
+	return bound;
+}
+
+#endif
+
+/****************************************************************************/
+/***                    Implementation of BTKaryTree                      ***/
+/****************************************************************************/
+
+template<class Key>
+template<class A>
+BTKaryTree<Key>::BTKaryTree(const BinaryTree<Key, A>& src)
+// PRE: 'src' is a search tree: its inorder traversal is sorted
+{
+	vector<Key> sorted;
+	src.inorder([&sorted](const Key& key) { sorted.push_back(key); });
+	init_sorted(sorted.data(), int(sorted.size()));
+}
+
+template<class Key>
+void BTKaryTree<Key>::init_sorted(const Key *sorted, int n_keys)
+// Replaces the contents by 'sorted[0]' ... 'sorted[n_keys - 1]', which
+// must be in increasing order.  The nodes are filled inorder, as in
+// 'EytzingerTree::init_sorted'; the slots left over at the end of the
+// order hold the largest key and are never reported
+{
+	if (n_keys < 0)
+		n_keys = 0;
+	this->n_keys = n_keys;
+	n_nodes = (n_keys + keys_per_node - 1) / keys_per_node;
+	level = bt_simd_supported();
+
+	vector<int32_t> encoded(n_keys);
+	for (int i = 0; i < n_keys; i++)
+		encoded[i] = encode(sorted[i]);
+	max_key = (n_keys ? encoded[n_keys - 1] : INT32_MIN);
+
+	// 15 more keys leave room to align the first node to 64 bytes
+	storage.assign(size_t(n_nodes) * keys_per_node + 15, INT32_MAX);
+	uintptr_t p = uintptr_t(storage.data());
+	int32_t *dest = (int32_t*) ((p + 63) & ~uintptr_t(63));
+	nodes = (n_nodes ? dest : NULL);
+	int next = 0;
+	fill(encoded.data(), next, 0, dest);
+}
+
+template<class Key>
+void BTKaryTree<Key>::init_sorted(const BTKaryTree& src)
+// The storage is copied as a whole, then the nodes are moved to the
+// alignment of the new buffer if it differs
+{
+	storage = src.storage;
+	n_nodes = src.n_nodes;
+	n_keys = src.n_keys;
+	max_key = src.max_key;
+	level = src.level;
+	nodes = NULL;
+	if (n_nodes) {
+		uintptr_t p = uintptr_t(storage.data());
+		int32_t *dest = (int32_t*) ((p + 63) & ~uintptr_t(63));
+		const int32_t *from = storage.data() + (src.nodes - src.storage.data());
+		memmove(dest, from, size_t(n_nodes) * keys_per_node * sizeof(int32_t));
+		nodes = dest;
+	}
+}
+
+template<class Key>
+void BTKaryTree<Key>::fill(const int32_t *sorted, int& next, size_t node,
+	int32_t *dest)
+// Fills the subtree of 'node' inorder, from 'sorted[next]' on: child
+// 'i', then key 'i', for every key, then the last child.  The recursion
+// depth is the height, about log17(n)
+{
+	if (node >= size_t(n_nodes))
+		return;
+	size_t first_child = 17 * node + 1;
+	for (int i = 0; i < keys_per_node; i++) {
+		fill(sorted, next, first_child + i, dest);
+		if (next < n_keys)
+			dest[node * keys_per_node + i] = sorted[next++];
+	}
+	fill(sorted, next, first_child + keys_per_node, dest);
+}
+
+template<class Key>
+void BTKaryTree<Key>::set_simd(BTSimdLevel level)
+// Levels the processor does not support fall back to the best one it
+// does
+{
+	this->level = min(level, bt_simd_supported());
+}
+
+/*************/
+/* Searching */
+/*************/
+
+template<class Key>
+int32_t BTKaryTree<Key>::encode(Key key)
+{
+	if (is_signed<Key>::value)
+		return int32_t(key);
+	return int32_t(uint32_t(key) ^ 0x80000000u);
+}
+
+template<class Key>
+Key BTKaryTree<Key>::decode(int32_t key)
+{
+	if (is_signed<Key>::value)
+		return Key(key);
+	return Key(uint32_t(key) ^ 0x80000000u);
+}
+
+template<class Key>
+const int32_t* BTKaryTree<Key>::search(int32_t key) const
+// Keys above the largest one would find a padding slot, so they are
+// turned away first
+{
+	if (key > max_key)
+		return NULL;
+#ifdef BT_X86
+	if (level == BTSimdAVX2)
+		return bt_kary_search_avx2(nodes, size_t(n_nodes), key);
+	if (level == BTSimdSSE2)
+		return bt_kary_search_sse2(nodes, size_t(n_nodes), key);
+#endif
+	return bt_kary_search_scalar(nodes, size_t(n_nodes), key);
+}
+
+template<class Key>
+bool BTKaryTree<Key>::lower_bound(Key key, Key& result) const
+{
+	const int32_t *bound = search(encode(key));
+	if (bound)
+		result = decode(*bound);
+	return bound != NULL;
+}
+
+template<class Key>
+bool BTKaryTree<Key>::contains(Key key) const
+{
+	int32_t k = encode(key);
+	const int32_t *bound = search(k);
+	return bound && *bound == k;
+}
@@ -0,0 +1,105 @@
+#ifndef __BTKaryTree_H
+#define __BTKaryTree_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "BinaryTree.h"
+
+using namespace std;
+
+/* The instruction sets a 'BTKaryTree' can compare its keys with */
+enum BTSimdLevel { BTSimdScalar, BTSimdSSE2, BTSimdAVX2 };
+
+/* The best of them that the processor running the program supports */
+inline BTSimdLevel bt_simd_supported();
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTKaryTree
+ *
+ ****************************************************************************/
+
+/* A 'BTKaryTree' is a frozen, read-only search tree of 32-bit integer
+ * keys ('Key' is 'int32_t' or 'uint32_t') with 16 keys per node, i.e.,
+ * 64 bytes: one cache line.  A search compares the query with all 16
+ * keys of a node at once, with SIMD instructions, and the number of keys
+ * less than the query picks one of the 17 children.  That is about four
+ * levels of a binary search for every cache miss.
+ *
+ * The nodes are in one aligned array, without pointers: the children of
+ * node 'k' are 'k*17 + 1' ... 'k*17 + 17', as in the Eytzinger layout
+ * with 17 children instead of 2 (see "EytzingerTree.h").  The last node
+ * is padded with the largest key.
+ *
+ * The comparison code is chosen when the tree is built, from what the
+ * processor supports (AVX2, else SSE2 on x86, else plain C++); it can be
+ * lowered with 'set_simd' for comparisons.
+ */
+
+template <class Key>
+class BTKaryTree {
+  static_assert(is_integral<Key>::value && sizeof(Key) == 4,
+                "BTKaryTree needs 32-bit integer keys");
+
+ public:
+  static const int keys_per_node = 16;
+
+  /* Construction, from keys in increasing order, or from the inorder
+   * traversal of a search tree */
+  BTKaryTree() { init_sorted(NULL, 0); }
+  BTKaryTree( const Key *sorted, int n_keys ) { init_sorted(sorted, n_keys); }
+  template<class A>
+  BTKaryTree( const BinaryTree<Key, A>& src );
+  BTKaryTree( const BTKaryTree& src ) { init_sorted(src); }
+  BTKaryTree& operator=( const BTKaryTree& src )
+    { if (this != &src) init_sorted(src); return *this; }
+
+  void init_sorted( const Key *sorted, int n_keys );
+
+  /* Access */
+  int node_count() const     { return n_keys; }
+  bool is_empty() const      { return n_keys == 0; }
+  BTSimdLevel simd() const   { return level; }
+  void set_simd( BTSimdLevel level );
+
+  /* Searching: 'lower_bound' sets 'result' to the least key that is not
+   * less than 'key' and returns true, or returns false if there is none */
+  bool lower_bound( Key key, Key& result ) const;
+  bool contains( Key key ) const;
+
+
+ protected:
+  vector<int32_t> storage;  // the nodes, with room for the alignment
+  const int32_t *nodes;     // the first node, aligned to 64 bytes
+  int n_nodes;
+  int n_keys;
+  int32_t max_key;          // largest key (encoded)
+  BTSimdLevel level;
+
+  /* Keys are stored as 'int32_t', ordered as signed numbers; unsigned
+   * keys have their top bit flipped to keep their order */
+  static int32_t encode( Key key );
+  static Key decode( int32_t key );
+
+  void init_sorted( const BTKaryTree& src );
+  void fill( const int32_t *sorted, int& next, size_t node, int32_t *dest );
+  const int32_t *search( int32_t key ) const;
+};
+
+
+#include "BTKaryTree.cpp"
+
+#endif
@@ -0,0 +1,297 @@
+//#include "BTMappedTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of BTMappedFile                     ***/
+/****************************************************************************/
+
+inline bool BTMappedFile::open(const string& path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(handle, &file_size) && file_size.QuadPart > 0)
+		mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping) {
+		base = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		// the view keeps the mapping alive
+		CloseHandle(mapping);
+	}
+	CloseHandle(handle);
+	if (base)
+		length = size_t(file_size.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *p = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			base = (const char*) p;
+			length = size_t(st.st_size);
+		}
+	}
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+#endif
+	return base != NULL;
+}
+
+inline void BTMappedFile::close()
+{
+	if (!base)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap((void*) base, length);
+#endif
+	base = NULL;
+	length = 0;
+}
+
+/****************************************************************************/
+/***                   Implementation of BTMappedTree                     ***/
+/****************************************************************************/
+
+template<class T>
+bool BTMappedTree<T>::open(const string& path)
+// The blocks must lie within the file, and the links must make a tree
+// (see 'valid_links'), so that a corrupt file cannot lead the walks out
+// of the element block
+{
+	close();
+	if (!file.open(path))
+		return false;
+
+	BTFileHeader header;
+	bool ok = file.size() >= sizeof(header);
+	if (ok) {
+		memcpy(&header, file.data(), sizeof(header));
+		uint64_t size = file.size(), n = header.node_count;
+		ok = memcmp(header.magic, "BTREE\0\0\0", 8) == 0
+			&& header.version == 1 && header.elem_size == sizeof(T)
+			&& n <= uint64_t(INT32_MAX)
+			&& header.elem_offset % 64 == 0 && header.link_offset % 64 == 0
+			&& header.elem_offset <= size
+			&& n * sizeof(T) <= size - header.elem_offset
+			&& (header.complete
+			    || (header.link_offset > 0 && header.link_offset <= size
+			        && n * 2 * sizeof(int32_t) <= size - header.link_offset));
+	}
+	if (ok && !header.complete) {
+		ok = valid_links((const int32_t*) (file.data() + header.link_offset),
+			int(header.node_count));
+	}
+	if (!ok) {
+		file.close();
+		return false;
+	}
+
+	elems = (const T*) (file.data() + header.elem_offset);
+	links = (header.complete ? NULL
+	         : (const int32_t*) (file.data() + header.link_offset));
+	n_nodes = int(header.node_count);
+	return true;
+}
+
+template<class T>
+bool BTMappedTree<T>::valid_links(const int32_t *links, int n)
+// The nodes are numbered in level order, so every child comes after its
+// parent; with every node but node 0 the child of exactly one parent
+// (n - 1 links in all), the links then form one tree, any walk from
+// node 0 ends, and it reaches every node.  One pass over the link block
+// checks that
+{
+	vector<bool> has_parent(n);
+	int n_links = 0;
+	for (int i = 0; i < n; i++) {
+		for (int side = 0; side < 2; side++) {
+			int32_t child = links[2*i + side];
+			if (child == -1)
+				continue;
+			if (child <= i || child >= n || has_parent[child])
+				return false;
+			has_parent[child] = true;
+			n_links++;
+		}
+	}
+	return n_links == (n > 0 ? n - 1 : 0);
+}
+
+template<class T>
+void BTMappedTree<T>::close()
+{
+	file.close();
+	elems = NULL;
+	links = NULL;
+	n_nodes = 0;
+}
+
+template<class T>
+template<class A>
+bool BTMappedTree<T>::write(const BinaryTree<T, A>& tree, const string& path)
+// The sparse encoding of the tree (see 'BinaryTree::to_sparse_array')
+// already lists the nodes in level order.  The tree is complete if no
+// link is present after the first absent one; otherwise the links are
+// numbered from it: in level order, the children of the nodes come in
+// the same order as the nodes themselves
+{
+	vector<bool> present;
+	vector<T> elements;
+	int n = tree.to_sparse_array(present, elements);
+
+	bool complete = true, gap = false;
+	for (size_t k = 0; k < present.size() && complete; k++) {
+		if (!present[k])
+			gap = true;
+		else if (gap)
+			complete = false;
+	}
+
+	BTFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BTREE\0\0\0", 8);
+	header.version = 1;
+	header.elem_size = sizeof(T);
+	header.complete = complete;
+	header.node_count = n;
+	header.elem_offset = (sizeof(header) + 63) / 64 * 64;
+	uint64_t elem_end = header.elem_offset + uint64_t(n) * sizeof(T);
+	header.link_offset = (complete ? 0 : (elem_end + 63) / 64 * 64);
+
+	ofstream out(path.c_str(), ios::binary | ios::trunc);
+	const char zeros[64] = { 0 };
+	out.write((const char*) &header, sizeof(header));
+	out.write(zeros, streamsize(header.elem_offset - sizeof(header)));
+	if (n > 0)
+		out.write((const char*) &elements[0], streamsize(n * sizeof(T)));
+	if (!complete) {
+		out.write(zeros, streamsize(header.link_offset - elem_end));
+		vector<int32_t> node_links(2 * n);
+		int32_t next = 1;
+		for (int k = 0; k < 2 * n; k++)
+			node_links[k] = (present[k + 1] ? next++ : -1);
+		out.write((const char*) &node_links[0],
+			streamsize(node_links.size() * sizeof(int32_t)));
+	}
+	out.close();
+	return !out.fail();
+}
+
+template<class T>
+int BTMappedTree<T>::height() const
+// A complete tree of n nodes has height floor(log2(n)) + 1; otherwise
+// a depth-first walk keeps the depth of every pending node
+{
+	if (!links) {
+		int h = 0;
+		for (int n = n_nodes; n > 0; n /= 2)
+			h++;
+		return h;
+	}
+
+	int h = 0;
+	vector<pair<int, int> > stack;
+	if (n_nodes > 0)
+		stack.push_back(make_pair(0, 1));
+	while (!stack.empty()) {
+		int node = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+		h = max(h, depth);
+		if (left(node) >= 0)
+			stack.push_back(make_pair(left(node), depth + 1));
+		if (right(node) >= 0)
+			stack.push_back(make_pair(right(node), depth + 1));
+	}
+	return h;
+}
+
+template<class T>
+int BTMappedTree<T>::leaf_count() const
+{
+	if (!links)
+		return (n_nodes + 1) / 2;
+	int n_leaves = 0;
+	for (int i = 0; i < n_nodes; i++) {
+		if (links[2*i] < 0 && links[2*i + 1] < 0)
+			n_leaves++;
+	}
+	return n_leaves;
+}
+
+/*
+ * The traversals keep the pending work on one stack of node numbers,
+ * where '~i' (a negative number) stands for "visit node 'i'" and 'i'
+ * for "expand the subtree of node 'i'"; the stack grows with the height
+ * of the tree only.
+ */
+
+template<class T>
+template<class F>
+void BTMappedTree<T>::walk_preorder(F& f) const
+{
+	vector<int> stack;
+	if (n_nodes > 0)
+		stack.push_back(0);
+	while (!stack.empty()) {
+		int node = stack.back();
+		stack.pop_back();
+		f(elems[node]);
+		if (right(node) >= 0)
+			stack.push_back(right(node));
+		if (left(node) >= 0)
+			stack.push_back(left(node));
+	}
+}
+
+template<class T>
+template<class F>
+void BTMappedTree<T>::walk_inorder(F& f) const
+{
+	vector<int> stack;
+	if (n_nodes > 0)
+		stack.push_back(0);
+	while (!stack.empty()) {
+		int node = stack.back();
+		stack.pop_back();
+		if (node < 0) {
+			f(elems[~node]);
+			continue;
+		}
+		if (right(node) >= 0)
+			stack.push_back(right(node));
+		stack.push_back(~node);
+		if (left(node) >= 0)
+			stack.push_back(left(node));
+	}
+}
+
+template<class T>
+template<class F>
+void BTMappedTree<T>::walk_postorder(F& f) const
+{
+	vector<int> stack;
+	if (n_nodes > 0)
+		stack.push_back(0);
+	while (!stack.empty()) {
+		int node = stack.back();
+		stack.pop_back();
+		if (node < 0) {
+			f(elems[~node]);
+			continue;
+		}
+		stack.push_back(~node);
+		if (right(node) >= 0)
+			stack.push_back(right(node));
+		if (left(node) >= 0)
+			stack.push_back(left(node));
+	}
+}
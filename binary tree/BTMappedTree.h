@@ -0,0 +1,161 @@
+#ifndef __BTMappedTree_H
+#define __BTMappedTree_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // keep std::min and std::max usable
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "BinaryTree.h"
+
+using namespace std;
+
+/*
+ * File format
+ * -----------
+ *
+ * A tree file holds a 'BTFileHeader', the element block and, unless the
+ * tree is complete, the link block.  All of it is in the byte order of
+ * the machine that wrote it.  The nodes are numbered 0, 1, 2 ... in
+ * level order, so the root is node 0:
+ *
+ *   - the element block has the elements of the nodes in that order,
+ *     byte for byte (the element type must be trivially copyable);
+ *   - for a complete tree the shape is implied: the children of node
+ *     'i' are '2*i + 1' and '2*i + 2', when they are below the count;
+ *   - otherwise the link block has two 32-bit node numbers for every
+ *     node, its left and right child, with -1 for no child.
+ *
+ * Both blocks start at offsets that are multiples of 64, so they can be
+ * used in place once the file is mapped into memory.
+ */
+
+struct BTFileHeader {
+  char magic[8];           // "BTREE" followed by zeros
+  uint32_t version;        // 1
+  uint32_t elem_size;      // sizeof(T) of the writer
+  uint32_t complete;       // 1 if the shape is implied, 0 if linked
+  uint32_t reserved;
+  uint64_t node_count;
+  uint64_t elem_offset;    // start of the element block
+  uint64_t link_offset;    // start of the link block (0 if complete)
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTMappedFile
+ *
+ ****************************************************************************/
+
+/* A 'BTMappedFile' maps a whole file read-only into memory */
+
+class BTMappedFile {
+ public:
+  BTMappedFile() : base(NULL), length(0) {}
+  ~BTMappedFile() { close(); }
+
+  bool open( const string& path );
+  void close();
+
+  const char *data() const { return base; }
+  size_t size() const      { return length; }
+
+ protected:
+  const char *base;  // start of the mapping (NULL if none)
+  size_t length;
+
+  BTMappedFile( const BTMappedFile& );             // not copyable
+  BTMappedFile& operator=( const BTMappedFile& );
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTMappedTree
+ *
+ ****************************************************************************/
+
+/* A 'BTMappedTree' is a read-only view of a tree file (see above).
+ * Opening one maps the file and checks the header; nothing is copied or
+ * built, so a tree of any size is ready at once, and the operating
+ * system only reads the pages that are actually visited.  The view has
+ * the same queries and traversals as 'BinaryTree' (all of them
+ * iterative), and 'write' saves a 'BinaryTree' in this format.
+ */
+
+template <class T>
+class BTMappedTree {
+  static_assert(is_trivially_copyable<T>::value,
+                "BTMappedTree needs a trivially copyable element type");
+
+ public:
+
+  /* Construction */
+  BTMappedTree() : elems(NULL), links(NULL), n_nodes(0) {}
+
+  /* Maps the file at 'path'; returns false if it cannot be opened or is
+   * not a tree file of this element type (the view is then empty) */
+  bool open( const string& path );
+  void close();
+
+  /* Saves 'tree' at 'path'; returns false on an I/O error */
+  template<class A>
+  static bool write( const BinaryTree<T, A>& tree, const string& path );
+
+  /* Access and Tests */
+  bool is_empty() const      { return n_nodes == 0; }
+  int height() const;
+  int node_count() const     { return n_nodes; }
+  int leaf_count() const;
+  bool is_complete() const   { return links == NULL; }
+
+  /* The element of node 'i', in level order (0 <= i < node_count) */
+  const T& operator[]( int i ) const { return elems[i]; }
+
+  /* Traversal */
+  void preorder( void (*f)(const T&) ) const  { walk_preorder(f); }
+  void inorder( void (*f)(const T&) ) const   { walk_inorder(f); }
+  void postorder( void (*f)(const T&) ) const { walk_postorder(f); }
+  template<class F> void preorder( F&& f ) const  { walk_preorder(f); }
+  template<class F> void inorder( F&& f ) const   { walk_inorder(f); }
+  template<class F> void postorder( F&& f ) const { walk_postorder(f); }
+
+
+ protected:
+  BTMappedFile file;
+  const T *elems;         // element block, in level order
+  const int32_t *links;   // link block (NULL for a complete tree)
+  int n_nodes;
+
+  /* Children of node 'i' (-1 if none) */
+  int left( int i ) const
+    { return links ? links[2*i] : (2*i + 1 < n_nodes ? 2*i + 1 : -1); }
+  int right( int i ) const
+    { return links ? links[2*i + 1] : (2*i + 2 < n_nodes ? 2*i + 2 : -1); }
+
+  static bool valid_links( const int32_t *links, int n );
+
+  template<class F> void walk_preorder( F& f ) const;
+  template<class F> void walk_inorder( F& f ) const;
+  template<class F> void walk_postorder( F& f ) const;
+};
+
+
+#include "BTMappedTree.cpp"
+
+#endif
@@ -0,0 +1,104 @@
+//#include "BTNodeAllocator.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of BTNodeArena                      ***/
+/****************************************************************************/
+
+template<class Node>
+BTNodeArena<Node>::BTNodeArena(int max_chunk_nodes)
+{
+	used = 0;
+	next_chunk_nodes = 16;
+	if (max_chunk_nodes < next_chunk_nodes)
+		max_chunk_nodes = next_chunk_nodes;
+	this->max_chunk_nodes = max_chunk_nodes;
+	free_list = NULL;
+}
+
+template<class Node>
+Node* BTNodeArena<Node>::allocate()
+{
+	// reuse a deallocated slot first
+	if (free_list) {
+		Slot *slot = free_list;
+		free_list = slot->next_free;
+		return (Node*) slot;
+	}
+
+	// start a new chunk when the last one is full (or there is none)
+	if (chunks.empty() || used == chunk_sizes.back()) {
+		chunks.push_back(new Slot[next_chunk_nodes]);
+		chunk_sizes.push_back(next_chunk_nodes);
+		used = 0;
+		if (next_chunk_nodes < max_chunk_nodes)
+			next_chunk_nodes = min(2 * next_chunk_nodes, max_chunk_nodes);
+	}
+
+	return (Node*) &chunks.back()[used++];
+}
+
+template<class Node>
+void BTNodeArena<Node>::deallocate(Node *node)
+{
+	// the slot is kept by the arena until 'release_all'
+	Slot *slot = (Slot*) node;
+	slot->next_free = free_list;
+	free_list = slot;
+}
+
+template<class Node>
+bool BTNodeArena<Node>::release_all()
+// Frees all chunks at once; every node handed out by this arena
+// becomes invalid
+{
+	for (size_t k = 0; k < chunks.size(); k++)
+		delete[] chunks[k];
+	chunks.clear();
+	chunk_sizes.clear();
+	used = 0;
+	next_chunk_nodes = 16;
+	free_list = NULL;
+	return true;
+}
+
+template<class Node>
+bool BTNodeArena<Node>::adopt(BTNodeAllocator<Node> *other)
+// Moves the chunks and the free slots of another arena into this one.
+// They go in front of the chunk being filled, so the unused rest of
+// the last chunk of 'other' is not used any more
+{
+	BTNodeArena *src = dynamic_cast<BTNodeArena*>(other);
+	if (!src)
+		return false;
+
+	// with no chunk of its own yet, the last adopted one counts as full
+	if (chunks.empty() && !src->chunks.empty())
+		used = src->chunk_sizes.back();
+	chunks.insert(chunks.begin(), src->chunks.begin(), src->chunks.end());
+	chunk_sizes.insert(chunk_sizes.begin(), src->chunk_sizes.begin(),
+		src->chunk_sizes.end());
+	if (src->free_list) {
+		Slot *last = src->free_list;
+		while (last->next_free)
+			last = last->next_free;
+		last->next_free = free_list;
+		free_list = src->free_list;
+	}
+
+	src->chunks.clear();
+	src->chunk_sizes.clear();
+	src->used = 0;
+	src->free_list = NULL;
+	return true;
+}
+
+template<class Node>
+size_t BTNodeArena<Node>::bytes_reserved() const
+{
+	size_t n_slots = 0;
+	for (size_t k = 0; k < chunk_sizes.size(); k++)
+		n_slots += chunk_sizes[k];
+	return n_slots * sizeof(Slot);
+}
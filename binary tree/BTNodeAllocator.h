@@ -0,0 +1,138 @@
+#ifndef __BTNodeAllocator_H
+#define __BTNodeAllocator_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BTNodeAllocator
+ *
+ ****************************************************************************/
+
+/* A 'BTNodeAllocator' hands out raw, suitably aligned storage for the
+ * nodes of a tree.  A tree never calls 'new'/'delete' on its nodes
+ * directly; it goes through its allocator, so the allocation strategy
+ * can be plugged in per tree.  The allocator only deals in storage:
+ * constructing and destroying the node objects is up to the caller.
+ */
+
+template <class Node>
+class BTNodeAllocator {
+ public:
+  virtual ~BTNodeAllocator() {}
+
+  /* Storage for one node, and giving it back */
+  virtual Node *allocate() = 0;
+  virtual void deallocate( Node *node ) = 0;
+
+  /* Frees the storage of every node handed out so far in one step.
+   * Returns false if the allocator cannot do that, in which case the
+   * nodes have to be deallocated one at a time. */
+  virtual bool release_all() { return false; }
+
+  /* A fresh, empty allocator of the same kind (for a new tree).  Every
+   * class deriving from an allocator must override it, or the copies of
+   * its trees get allocators of the base class */
+  virtual BTNodeAllocator *spawn() const = 0;
+
+  /* Takes over all the storage of another allocator (obtained from
+   * 'spawn'), so that the nodes it handed out now belong to this one and
+   * the other one is left empty.  Returns false if this is not possible. */
+  virtual bool adopt( BTNodeAllocator* ) { return false; }
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTNodeHeap
+ *
+ ****************************************************************************/
+
+/* A 'BTNodeHeap' simply uses the global 'operator new' for each node.
+ * It keeps no state, so one instance may be shared by any number of
+ * trees (and threads), and it adopts another heap by doing nothing.
+ * That does not hold for a class derived from it, which may keep state
+ * per node: 'adopt' fails unless the other allocator is of exactly the
+ * same class, and such a class must override 'adopt' to accept even
+ * that if its nodes cannot simply change hands.
+ */
+
+template <class Node>
+class BTNodeHeap : public BTNodeAllocator<Node> {
+ public:
+  Node *allocate() { return (Node*) ::operator new(sizeof(Node)); }
+  void deallocate( Node *node ) { ::operator delete(node); }
+  BTNodeAllocator<Node> *spawn() const { return new BTNodeHeap; }
+  bool adopt( BTNodeAllocator<Node> *other )
+    { return typeid(*other) == typeid(*this); }
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTNodeArena
+ *
+ ****************************************************************************/
+
+/* A 'BTNodeArena' carves nodes out of large chunks (slabs) that belong
+ * to a single tree.  Nodes of a bulk build end up next to each other
+ * in memory, and the whole tree can be freed by 'release_all()' without
+ * visiting the nodes.  Individually deallocated nodes go on a free list
+ * and are reused by later allocations.
+ *
+ * The chunks start small and double in size up to 'max_chunk_nodes',
+ * so that small trees do not pay for a large slab.
+ *
+ * NOTE:  An arena is not thread-safe; it is meant to be owned by one tree.
+ */
+
+template <class Node>
+class BTNodeArena : public BTNodeAllocator<Node> {
+ public:
+
+  /* Construction */
+  BTNodeArena( int max_chunk_nodes = 4096 );
+  ~BTNodeArena() { release_all(); }
+
+  /* Allocation */
+  Node *allocate();
+  void deallocate( Node *node );
+  bool release_all();
+  BTNodeAllocator<Node> *spawn() const
+    { return new BTNodeArena(max_chunk_nodes); }
+  bool adopt( BTNodeAllocator<Node> *other );
+
+  /* Statistics */
+  size_t chunk_count() const { return chunks.size(); }
+  size_t bytes_reserved() const;
+
+ protected:
+  /* A cell of a chunk: either a node or a link in the free list */
+  union Slot {
+    Slot *next_free;
+    typename aligned_storage<sizeof(Node),
+                             alignment_of<Node>::value>::type storage;
+  };
+
+  vector<Slot*> chunks;      // all chunks, the last one being filled
+  vector<int> chunk_sizes;   // number of slots in each chunk
+  int used;                  // slots used in the last chunk
+  int next_chunk_nodes;      // size of the next chunk to be allocated
+  int max_chunk_nodes;       // upper bound on the chunk size
+  Slot *free_list;           // deallocated slots, ready for reuse
+
+  BTNodeArena( const BTNodeArena& );             // not copyable
+  BTNodeArena& operator=( const BTNodeArena& );
+};
+
+
+#include "BTNodeAllocator.cpp"
+
+#endif
@@ -0,0 +1,62 @@
+//#include "BTReclaimer.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                    Implementation of BTReclaimer                     ***/
+/****************************************************************************/
+
+inline BTReclaimer::BTReclaimer()
+	: busy(false), stopping(false)
+{
+	// start the thread last, once every member is initialized
+	worker = thread(&BTReclaimer::worker_loop, this);
+}
+
+inline BTReclaimer::~BTReclaimer()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+inline void BTReclaimer::defer(const function<void()>& job)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		jobs.push_back(job);
+	}
+	changed.notify_all();
+}
+
+inline void BTReclaimer::drain()
+{
+	unique_lock<mutex> guard(lock);
+	while (!jobs.empty() || busy)
+		changed.wait(guard);
+}
+
+inline void BTReclaimer::worker_loop()
+// Runs the jobs one at a time; on 'stopping' the remaining ones are
+// still run before the thread ends
+{
+	unique_lock<mutex> guard(lock);
+	for (;;) {
+		while (jobs.empty() && !stopping)
+			changed.wait(guard);
+		if (jobs.empty())
+			break;
+
+		function<void()> job = jobs.front();
+		jobs.pop_front();
+		busy = true;
+		guard.unlock();
+		job();
+		guard.lock();
+		busy = false;
+		changed.notify_all();
+	}
+}
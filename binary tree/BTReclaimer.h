@@ -0,0 +1,56 @@
+#ifndef __BTReclaimer_H
+#define __BTReclaimer_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BTReclaimer
+ *
+ ****************************************************************************/
+
+/* A 'BTReclaimer' frees detached trees on a background thread, so that
+ * a latency-sensitive caller does not have to wait for a large tree to
+ * be torn down (see 'BinaryTree::empty_this(BTReclaimer&)').  The work
+ * is done in the order it was handed over; the destructor finishes all
+ * of it before it returns.
+ */
+
+class BTReclaimer {
+ public:
+
+  /* Construction */
+  BTReclaimer();
+  ~BTReclaimer();
+
+  /* Hands 'job' to the background thread and returns right away */
+  void defer( const function<void()>& job );
+
+  /* Waits until all the work handed over so far is done */
+  void drain();
+
+
+ protected:
+  deque<function<void()> > jobs;  // work not yet started
+  bool busy;                      // a job is being run
+  bool stopping;
+  mutex lock;
+  condition_variable changed;
+  thread worker;
+
+  void worker_loop();
+
+  BTReclaimer( const BTReclaimer& );             // not copyable
+  BTReclaimer& operator=( const BTReclaimer& );
+};
+
+
+#include "BTReclaimer.cpp"
+
+#endif
@@ -0,0 +1,204 @@
+//#include "BTThreadPool.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of BTThreadPool                     ***/
+/****************************************************************************/
+
+/* The pool a worker thread belongs to, and its index in that pool */
+struct BTWorkerId {
+	const BTThreadPool *pool;
+	int index;
+};
+
+inline BTWorkerId& bt_current_worker()
+{
+	static thread_local BTWorkerId id = { NULL, -1 };
+	return id;
+}
+
+/****************/
+/* Construction */
+/****************/
+
+inline BTThreadPool::BTThreadPool(int n_threads)
+	: pending(0), sleepers(0), stopping(false)
+{
+	if (n_threads <= 0)
+		n_threads = max(1u, thread::hardware_concurrency());
+	n_deques = n_threads + 1;
+	deques = new Deque[n_deques];
+	for (int k = 0; k < n_threads; k++)
+		workers.push_back(thread(&BTThreadPool::worker_loop, this, k));
+}
+
+inline BTThreadPool::~BTThreadPool()
+{
+	{
+		lock_guard<mutex> guard(sleep_lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t k = 0; k < workers.size(); k++)
+		workers[k].join();
+	delete[] deques;
+}
+
+inline int BTThreadPool::default_fork_depth() const
+// Enough levels for about 16 subtrees per thread
+{
+	int depth = 4;
+	for (int n = 1; n < thread_count(); n *= 2)
+		depth++;
+	return depth;
+}
+
+/*************/
+/* Fork-join */
+/*************/
+
+template<class A, class B>
+void BTThreadPool::invoke(A&& a, B&& b)
+// 'task_b' lives on this stack frame, so it must be out of the deques
+// before the frame is left, also when 'a()' throws: it is then taken
+// back without being run, or waited for if another thread has it
+{
+	int self = self_index();
+	TaskOf<B> task_b(b);
+	push(self, &task_b);
+
+	try {
+		a();
+	}
+	catch (...) {
+		if (!pop_if(self, &task_b))
+			wait_for(self, &task_b);
+		throw;
+	}
+
+	// run 'b' here unless another thread took it
+	if (pop_if(self, &task_b))
+		task_b.run();
+	else {
+		wait_for(self, &task_b);
+		if (task_b.error)
+			rethrow_exception(task_b.error);
+	}
+}
+
+inline void BTThreadPool::wait_for(int self, Task *task)
+// Helps out with other work until 'task', taken by another thread, is
+// done
+{
+	while (!task->done.load(memory_order_acquire)) {
+		Task *other = find_task(self);
+		if (other)
+			execute(other);
+		else
+			this_thread::yield();
+	}
+}
+
+/**********/
+/* Deques */
+/**********/
+
+inline int BTThreadPool::self_index() const
+// The deque of the calling thread: its own for a worker of this pool,
+// the shared last one otherwise
+{
+	if (bt_current_worker().pool == this)
+		return bt_current_worker().index;
+	return n_deques - 1;
+}
+
+inline void BTThreadPool::push(int self, Task *task)
+{
+	{
+		lock_guard<mutex> guard(deques[self].lock);
+		deques[self].tasks.push_back(task);
+	}
+	pending++;
+
+	// wake a sleeping worker to steal it
+	if (sleepers.load() > 0) {
+		lock_guard<mutex> guard(sleep_lock);
+		wake.notify_one();
+	}
+}
+
+inline bool BTThreadPool::pop_if(int self, Task *task)
+// Takes 'task' back from the bottom of deque 'self', if it is still there
+{
+	lock_guard<mutex> guard(deques[self].lock);
+	deque<Task*>& tasks = deques[self].tasks;
+	if (tasks.empty() || tasks.back() != task)
+		return false;
+	tasks.pop_back();
+	pending--;
+	return true;
+}
+
+inline BTThreadPool::Task* BTThreadPool::find_task(int self)
+// The newest task of deque 'self', or else the oldest task of any
+// other deque (stealing); NULL if there is no work at all
+{
+	if (pending.load() == 0)
+		return NULL;
+	for (int k = 0; k < n_deques; k++) {
+		int victim = (self + k) % n_deques;
+		lock_guard<mutex> guard(deques[victim].lock);
+		deque<Task*>& tasks = deques[victim].tasks;
+		if (tasks.empty())
+			continue;
+		Task *task;
+		if (k == 0) {
+			task = tasks.back();
+			tasks.pop_back();
+		}
+		else {
+			task = tasks.front();
+			tasks.pop_front();
+		}
+		pending--;
+		return task;
+	}
+	return NULL;
+}
+
+inline void BTThreadPool::execute(Task *task)
+// Runs a task taken from a deque.  Its exception must not leave this
+// thread, which may be a worker or be helping an unrelated 'invoke':
+// it is handed over to the owner of the task, which is waiting for
+// 'done' in any case
+{
+	try {
+		task->run();
+	}
+	catch (...) {
+		task->error = current_exception();
+	}
+	task->done.store(true, memory_order_release);
+}
+
+inline void BTThreadPool::worker_loop(int index)
+{
+	bt_current_worker().pool = this;
+	bt_current_worker().index = index;
+
+	while (!stopping) {
+		Task *task = find_task(index);
+		if (task) {
+			execute(task);
+			continue;
+		}
+
+		// nothing to do: sleep until a task is pushed
+		unique_lock<mutex> guard(sleep_lock);
+		sleepers++;
+		while (!stopping && pending.load() == 0)
+			wake.wait(guard);
+		sleepers--;
+	}
+}
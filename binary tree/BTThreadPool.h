@@ -0,0 +1,110 @@
+#ifndef __BTThreadPool_H
+#define __BTThreadPool_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BTThreadPool
+ *
+ ****************************************************************************/
+
+/* A 'BTThreadPool' runs fork-join computations over trees on a fixed set
+ * of worker threads with work stealing.  The only primitive is
+ * 'invoke(a, b)', which runs the two callables, possibly in parallel,
+ * and returns when both are done:
+ *
+ *   - 'b' is pushed on the task deque of the calling thread and 'a' is
+ *     run right away;
+ *   - an idle thread steals the oldest task from another thread's deque,
+ *     which for a recursive walk is the largest piece of work left;
+ *   - if nobody has stolen 'b' by the time 'a' is done, the caller runs
+ *     it itself; otherwise it helps with other tasks until 'b' is done.
+ *
+ * Threads that are not workers of the pool (e.g. the one starting the
+ * computation) may call 'invoke' too; they share one extra deque and help
+ * in the same way while they wait.
+ */
+
+class BTThreadPool {
+ public:
+
+  /* Construction; 'n_threads' <= 0 means one per hardware thread */
+  BTThreadPool( int n_threads = 0 );
+  ~BTThreadPool();
+
+  /* Access */
+  int thread_count() const { return int(workers.size()); }
+
+  /* The depth down to which a recursive walk should fork subtrees to
+   * give every thread enough pieces to balance the load */
+  int default_fork_depth() const;
+
+  /* Runs 'a()' and 'b()', possibly in parallel.  If 'a()' throws, 'b()'
+   * is skipped unless another thread has already started it, and the
+   * exception is passed on once 'b()' is out of the pool.  An exception
+   * from 'b()' is passed on too, whichever thread ran it (if both
+   * throw, the one from 'a()' wins) */
+  template<class A, class B>
+  void invoke( A&& a, B&& b );
+
+
+ protected:
+  /* A unit of work pushed on a deque; it lives on the stack of the
+   * 'invoke' call that created it.  When another thread runs it, an
+   * exception it throws is kept in 'error' for that call to rethrow */
+  struct Task {
+    atomic<bool> done;
+    exception_ptr error;
+    Task() : done(false) {}
+    virtual void run() = 0;
+  };
+  template<class F>
+  struct TaskOf : public Task {
+    F& f;
+    TaskOf( F& f ) : f(f) {}
+    void run() { f(); }
+  };
+
+  /* One deque of tasks per worker, plus a shared one (the last) for
+   * threads outside the pool */
+  struct Deque {
+    mutex lock;
+    deque<Task*> tasks;
+  };
+
+  vector<thread> workers;
+  Deque *deques;
+  int n_deques;
+
+  atomic<int> pending;     // tasks sitting in the deques
+  atomic<int> sleepers;    // workers waiting for 'pending' to become > 0
+  atomic<bool> stopping;
+  mutex sleep_lock;
+  condition_variable wake;
+
+  int self_index() const;
+  void push( int self, Task *task );
+  bool pop_if( int self, Task *task );
+  Task *find_task( int self );
+  void wait_for( int self, Task *task );
+  void execute( Task *task );
+  void worker_loop( int index );
+
+  BTThreadPool( const BTThreadPool& );              // not copyable
+  BTThreadPool& operator=( const BTThreadPool& );
+};
+
+
+#include "BTThreadPool.cpp"
+
+#endif
@@ -0,0 +1,168 @@
+//#include "BinarySearchTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                 Implementation of BinarySearchTree                   ***/
+/****************************************************************************/
+
+template<class T, class Compare, class A>
+BinarySearchTree<T, Compare, A>::BinarySearchTree(const T *sorted,
+	int n_elements, const Compare& less_than)
+	: less_than(less_than)
+{
+	init_sorted(sorted, n_elements);
+}
+
+/*************/
+/* Searching */
+/*************/
+
+template<class T, class Compare, class A>
+const T* BinarySearchTree<T, Compare, A>::find(const T& elem) const
+{
+	Node *node = this->root;
+	while (node) {
+		if (less_than(elem, node->elem))
+			node = node->left;
+		else if (less_than(node->elem, elem))
+			node = node->right;
+		else
+			return &node->elem;
+	}
+	return NULL;
+}
+
+template<class T, class Compare, class A>
+const T* BinarySearchTree<T, Compare, A>::lower_bound(const T& elem) const
+// The last node at which the search went left is the best candidate
+// so far
+{
+	Node *node = this->root, *bound = NULL;
+	while (node) {
+		if (less_than(node->elem, elem))
+			node = node->right;
+		else {
+			bound = node;
+			node = node->left;
+		}
+	}
+	return (bound ? &bound->elem : NULL);
+}
+
+/************/
+/* Mutators */
+/************/
+
+template<class T, class Compare, class A>
+bool BinarySearchTree<T, Compare, A>::insert(const T& elem)
+// The new element becomes a leaf at the end of the search path; the
+// nodes on the path are updated afterwards, bottom-up (the path is only
+// recorded if there is augmented data to update)
+{
+	vector<Node**> path;
+	Node **link = find_link(elem, tracks_path ? &path : NULL);
+	if (*link)
+		return false;
+	*link = this->new_node(elem);
+	update_path(path);
+	return true;
+}
+
+template<class T, class Compare, class A>
+bool BinarySearchTree<T, Compare, A>::erase(const T& elem)
+{
+	vector<Node**> path;
+	Node **link = find_link(elem, tracks_path ? &path : NULL);
+	if (!*link)
+		return false;
+	remove_at(link, tracks_path ? &path : NULL);
+	update_path(path);
+	return true;
+}
+
+template<class T, class Compare, class A>
+BTNode<T, A>** BinarySearchTree<T, Compare, A>::find_link(const T& elem,
+	vector<Node**> *path)
+// Returns the link that points to the node of 'elem', or that would
+// point to it (it then holds NULL).  If 'path' is not NULL, the links
+// leading to the ancestors of that node are appended to it, from the
+// root down
+{
+	Node **link = &this->root;
+	while (*link) {
+		Node **next;
+		if (less_than(elem, (*link)->elem))
+			next = &(*link)->left;
+		else if (less_than((*link)->elem, elem))
+			next = &(*link)->right;
+		else
+			break;
+		if (path)
+			path->push_back(link);
+		link = next;
+	}
+	return link;
+}
+
+template<class T, class Compare, class A>
+void BinarySearchTree<T, Compare, A>::remove_at(Node **link,
+	vector<Node**> *path)
+// Removes the node '*link'.  A node with two children takes the element
+// of its inorder successor (the leftmost node of its right subtree),
+// which is removed instead; a node with at most one child is replaced
+// by that child.  The links to the nodes whose subtrees changed below
+// 'link' are appended to 'path', if it is not NULL
+{
+	Node *node = *link;
+	if (node->left && node->right) {
+		if (path)
+			path->push_back(link);
+		Node **succ = &node->right;
+		while ((*succ)->left) {
+			if (path)
+				path->push_back(succ);
+			succ = &(*succ)->left;
+		}
+		node->elem = (*succ)->elem;
+		link = succ;
+		node = *succ;
+	}
+	*link = (node->left ? node->left : node->right);
+	this->delete_node(node);
+}
+
+template<class T, class Compare, class A>
+void BinarySearchTree<T, Compare, A>::update_path(vector<Node**>& path)
+// Brings the augmented data of the nodes of 'path', listed from the
+// root down, up to date
+{
+	for (size_t k = path.size(); k-- > 0; )
+		A::update(*path[k]);
+}
+
+/****************/
+/* Bulk loading */
+/****************/
+
+template<class T, class Compare, class A>
+void BinarySearchTree<T, Compare, A>::init_sorted(const T *sorted,
+	int n_elements)
+{
+	this->empty_this();
+	this->root = init_sorted(sorted, 0, n_elements);
+}
+
+template<class T, class Compare, class A>
+BTNode<T, A>* BinarySearchTree<T, Compare, A>::init_sorted(const T *sorted,
+	int lo, int hi)
+// Builds the subtree of 'sorted[lo]' ... 'sorted[hi - 1]' around the
+// middle element, so that the sizes of the two subtrees differ by one
+// at most; the recursion depth is the height of the result, O(log n)
+{
+	if (hi <= lo)
+		return NULL;
+	int mid = lo + (hi - lo) / 2;
+	return this->new_node(sorted[mid], init_sorted(sorted, lo, mid),
+		init_sorted(sorted, mid + 1, hi));
+}
@@ -0,0 +1,87 @@
+#ifndef __BinarySearchTree_H
+#define __BinarySearchTree_H
+
+#include <functional>
+#include <vector>
+
+#include "BinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  BinarySearchTree
+ *
+ ****************************************************************************/
+
+/* A 'BinarySearchTree' keeps its elements in the order given by
+ * 'Compare': every element of the left subtree of a node is less than
+ * the element of the node, and every element of the right subtree is
+ * greater.  Elements are unique.  The inorder traversals and iterators
+ * of 'BinaryTree' thus visit the elements in increasing order.
+ *
+ * 'insert', 'find', 'erase' and 'lower_bound' walk a single path, so
+ * they take O(height) time; the tree does not rebalance itself, but
+ * 'init_sorted' builds a perfectly balanced tree from a sorted range in
+ * O(n).  The inherited mutators that take no account of the order
+ * ('init_complete' and the like) are private, so that only the ones
+ * above can change a search tree.
+ */
+
+template <class T, class Compare = less<T>, class A = BTNoAugment>
+class BinarySearchTree : public BinaryTree<T, A> {
+ public:
+  typedef BTNode<T, A> Node;
+
+  /* Construction */
+  explicit BinarySearchTree( const Compare& less_than = Compare() )
+    : less_than(less_than) {}
+  BinarySearchTree( const T *sorted, int n_elements,
+                    const Compare& less_than = Compare() );
+
+  /* Searching: the element equal to 'elem', or the least element that
+   * is not less than 'elem'; NULL if there is none */
+  const T *find( const T& elem ) const;
+  const T *lower_bound( const T& elem ) const;
+  bool contains( const T& elem ) const { return find(elem) != NULL; }
+
+  /* Mutators; they return false if 'elem' is already in the tree, or
+   * not in it, respectively */
+  bool insert( const T& elem );
+  bool erase( const T& elem );
+
+  /* Replaces the contents by 'sorted[0]' ... 'sorted[n_elements - 1]',
+   * which must be in strictly increasing order, as a perfectly balanced
+   * tree */
+  void init_sorted( const T *sorted, int n_elements );
+
+
+ private:
+  /* Inherited mutators that would place elements out of order */
+  using BinaryTree<T, A>::init_complete;
+  using BinaryTree<T, A>::init_sparse;
+  using BinaryTree<T, A>::init_preorder_inorder;
+  using BinaryTree<T, A>::init_postorder_inorder;
+  using BinaryTree<T, A>::read_complete;
+  using BinaryTree<T, A>::read_preorder;
+  using BinaryTree<T, A>::preorder_mutable;
+  using BinaryTree<T, A>::inorder_mutable;
+  using BinaryTree<T, A>::postorder_mutable;
+
+ protected:
+  Compare less_than;
+
+  /* Whether the mutators must record their search path, to update the
+   * augmented data of the nodes on it */
+  static const bool tracks_path = !is_same<A, BTNoAugment>::value;
+
+  Node **find_link( const T& elem, vector<Node**> *path );
+  void remove_at( Node **link, vector<Node**> *path );
+  Node *init_sorted( const T *sorted, int lo, int hi );
+  static void update_path( vector<Node**>& path );
+};
+
+
+#include "BinarySearchTree.cpp"
+
+#endif
@@ -77,18 +77,31 @@ using namespace std;
 /* Construction */
 /****************/
 
-template<class T>
-BinaryTree<T>::BinaryTree(T *elements, int n_elements)
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(BTNodeAllocator<BTNode<T, A> > *alloc, bool own_alloc)
+// Constructs an empty tree whose nodes will come from 'alloc'; if
+// 'own_alloc' is true the tree takes over the allocator and deletes it
+// along with the tree
+{
+	root = NULL;
+	this->alloc = alloc;
+	this->own_alloc = own_alloc;
+}
+
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(T *elements, int n_elements)
 // Constructs this tree to have elements 'elements[1]', 'elements[2]' ...
 // as a complete binary tree (see above); 'element[0]' is ignored,
 // so the total number of cells if 'elements' is 'n_elements + 1'
 {
 	root = NULL;
+	alloc = NULL;
+	own_alloc = true;
 	init_complete(elements, n_elements);
 }
 
-template<class T>
-void BinaryTree<T>::init_complete(T *elements, int n_elements)
+template<class T, class A>
+void BinaryTree<T, A>::init_complete(T *elements, int n_elements)
 // Initializes this tree, regarding it as a complete binary tree
 // having elements 'elements[1]', 'elements[2]', ... (see above)
 {
@@ -96,8 +109,8 @@ void BinaryTree<T>::init_complete(T *elements, int n_elements)
 	root = init_complete(elements, n_elements, 1);
 }
 
-template<class T>
-BTNode<T>* BinaryTree<T>::init_complete(T *elements, int n_elements,int index)
+template<class T, class A>
+BTNode<T, A>* BinaryTree<T, A>::init_complete(T *elements, int n_elements,int index)
 	// Initializes this tree, regarding it as a complete binary tree,
 	// starting at the array node at 'index'
 {
@@ -107,40 +120,185 @@ BTNode<T>* BinaryTree<T>::init_complete(T *elements, int n_elements,int index)
 
 	// create a new node, with left and right children assigned by
 	// the recursive call
-	return new BTNode<T>(elements[index],
+	return new_node(elements[index],
 		init_complete(elements, n_elements, 2 * index),
 		init_complete(elements, n_elements, 2 * index + 1));
 }
 
-template<class T>
-BinaryTree<T>::BinaryTree(const BinaryTree& src)
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(const BinaryTree& src)
+// The copy gets an allocator of its own if 'src' has one of its own,
+// and shares the allocator of 'src' otherwise
 {
+	root = NULL;
+	own_alloc = src.own_alloc;
+	if (own_alloc)
+		alloc = (src.alloc ? src.alloc->spawn() : NULL);
+	else
+		alloc = src.alloc;
 	root = clone(src.root);
 }
 
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(const BinaryTree& src, BTThreadPool& pool,
+	int fork_depth)
+// A copy constructor that clones in parallel.  The top 'fork_depth'
+// levels of 'src' are copied here; the subtrees below them ("pieces")
+// are cloned by the threads of 'pool', each into an allocator of its
+// own, whose storage is then handed over to the allocator of this tree
+{
+	root = NULL;
+	own_alloc = src.own_alloc;
+	if (own_alloc)
+		alloc = (src.alloc ? src.alloc->spawn() : NULL);
+	else
+		alloc = src.alloc;
+	if (!src.root)
+		return;
+	if (fork_depth < 0)
+		fork_depth = pool.default_fork_depth();
+
+	// the allocator must be able to take over the storage of the pieces
+	BTNodeAllocator<BTNode<T, A> > *probe = allocator()->spawn();
+	bool can_adopt = alloc->adopt(probe);
+	delete probe;
+	if (!can_adopt) {
+		root = clone(src.root);
+		return;
+	}
+
+	vector<ClonePiece> pieces;
+	try {
+		clone_top(src.root, &root, fork_depth, pieces);
+		for (size_t k = 0; k < pieces.size(); k++)
+			pieces[k].alloc = alloc->spawn();
+		clone_pieces(pool, pieces, 0, int(pieces.size()));
+	}
+	catch (...) {
+		// every piece is out of the pool once the exception gets here;
+		// the ones cloned so far are freed with their allocators, then
+		// the top levels (no destructor will do it)
+		for (size_t k = 0; k < pieces.size(); k++) {
+			if (pieces[k].alloc) {
+				empty(*pieces[k].dest, pieces[k].alloc);
+				delete pieces[k].alloc;
+			}
+			*pieces[k].dest = NULL;
+		}
+		empty(root);
+		if (own_alloc)
+			delete alloc;
+		throw;
+	}
+	for (size_t k = 0; k < pieces.size(); k++) {
+		alloc->adopt(pieces[k].alloc);
+		delete pieces[k].alloc;
+	}
+
+	// the augmented data of the top levels could only be computed now
+	update_top(root, fork_depth);
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::clone_top(BTNode<T, A> *src, BTNode<T, A> **dest,
+	int depth, vector<ClonePiece>& pieces)
+// Copies the top 'depth' levels of the subtree 'src' to '*dest'; every
+// subtree right below them becomes a piece to be cloned into its place
+{
+	*dest = NULL;
+	if (!src)
+		return;
+	if (depth == 0) {
+		ClonePiece piece = { src, dest, NULL };
+		pieces.push_back(piece);
+		return;
+	}
+	*dest = new_node(src->elem);
+	clone_top(src->left, &(*dest)->left, depth - 1, pieces);
+	clone_top(src->right, &(*dest)->right, depth - 1, pieces);
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::clone_pieces(BTThreadPool& pool,
+	vector<ClonePiece>& pieces, int lo, int hi)
+// Clones 'pieces[lo]' ... 'pieces[hi - 1]', splitting the range in
+// halves across the pool
+{
+	if (hi <= lo)
+		return;
+	if (hi - lo == 1) {
+		ClonePiece& piece = pieces[lo];
+		*piece.dest = clone(piece.src, piece.alloc);
+		return;
+	}
+	int mid = (lo + hi) / 2;
+	pool.invoke([&] { clone_pieces(pool, pieces, lo, mid); },
+		[&] { clone_pieces(pool, pieces, mid, hi); });
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::update_top(BTNode<T, A> *node, int depth)
+// Recomputes the augmented data of the top 'depth' levels, bottom-up
+{
+	if (!node || depth == 0)
+		return;
+	update_top(node->left, depth - 1);
+	update_top(node->right, depth - 1);
+	A::update(node);
+}
+
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(BinaryTree&& src) noexcept
+// Takes over the nodes of 'src' (and its allocator, if it has one of
+// its own), leaving 'src' empty
+{
+	root = src.root;
+	alloc = src.alloc;
+	own_alloc = src.own_alloc;
+	src.root = NULL;
+	if (src.own_alloc)
+		src.alloc = NULL;
+}
+
+template<class T, class A>
+BinaryTree<T, A>::~BinaryTree()
+{
+	empty_this();
+	if (own_alloc)
+		delete alloc;
+}
+
 /********************/
 /* Access and Tests */
 /********************/
 
-template<class T>
-int BinaryTree<T>::node_count(BTNode<T> *node) const
+template<class T, class A>
+int BinaryTree<T, A>::node_count(BTNode<T, A> *node) const
 {
+	// constant time if the augmentation keeps the subtree sizes
+	int cached = A::cached_size(node);
+	if (cached >= 0)
+		return cached;
 	if (node == NULL)
 		return 0;
 	return 1 + node_count(node->left) + node_count(node->right);
 }
 
-template<class T>
-bool BinaryTree<T>::is_empty() const
+template<class T, class A>
+bool BinaryTree<T, A>::is_empty() const
 {
 	if (root)
 		return 0;
 	return 1;
 }
 
-template<class T>
-int BinaryTree<T>::height( BTNode<T>* node ) const
+template<class T, class A>
+int BinaryTree<T, A>::height( BTNode<T, A>* node ) const
 {
+	// constant time if the augmentation keeps the subtree heights
+	int cached = A::cached_height(node);
+	if (cached >= 0)
+		return cached;
 	if (!node)
 		return 0;
 	else if ((*node).is_leaf())
@@ -156,8 +314,17 @@ int BinaryTree<T>::height( BTNode<T>* node ) const
 	}
 }
 
-template<class T>
-int BinaryTree<T>::leaf_count(BTNode<T>* node) const
+template<class T, class A>
+int BinaryTree<T, A>::balance_factor(BTNode<T, A>* node) const
+// PRE: 'node' is not NULL
+// The height of the left subtree of 'node' minus the height of its
+// right subtree; constant time if the augmentation keeps the heights
+{
+	return height(node->left) - height(node->right);
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::leaf_count(BTNode<T, A>* node) const
 {
 	if(!node)
 		return 0;
@@ -167,12 +334,106 @@ int BinaryTree<T>::leaf_count(BTNode<T>* node) const
 		return leaf_count((*node).left) + leaf_count((*node).right);
 }
 
+template<class T, class A>
+const T& BinaryTree<T, A>::select(int k) const
+// PRE: 0 <= k < node_count()
+// Returns the element at position 'k' of the inorder sequence.  With
+// cached subtree sizes this descends a single path from the root;
+// otherwise it counts its way along the inorder iterator
+{
+	if (A::cached_size(root) < 0) {
+		iterator it = begin();
+		while (k-- > 0)
+			++it;
+		return *it;
+	}
+
+	BTNode<T, A> *node = root;
+	for (;;) {
+		int n_left = A::cached_size(node->left);
+		if (k < n_left)
+			node = node->left;
+		else if (k == n_left)
+			return node->elem;
+		else {
+			k -= n_left + 1;
+			node = node->right;
+		}
+	}
+}
+
+/*
+ * Parallel statistics.  Each helper forks the walks of the two
+ * subtrees as long as 'fork_depth' levels remain, then falls back to
+ * the serial helper above.
+ */
+
+template<class T, class A>
+int BinaryTree<T, A>::height(BTThreadPool& pool, int fork_depth) const
+{
+	if (fork_depth < 0)
+		fork_depth = pool.default_fork_depth();
+	return height(pool, root, fork_depth);
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::node_count(BTThreadPool& pool, int fork_depth) const
+{
+	if (fork_depth < 0)
+		fork_depth = pool.default_fork_depth();
+	return node_count(pool, root, fork_depth);
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::leaf_count(BTThreadPool& pool, int fork_depth) const
+{
+	if (fork_depth < 0)
+		fork_depth = pool.default_fork_depth();
+	return leaf_count(pool, root, fork_depth);
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::height(BTThreadPool& pool, BTNode<T, A>* node,
+	int fork_depth) const
+{
+	if (!node || fork_depth == 0 || node->is_leaf())
+		return height(node);
+	int lh, rh;
+	pool.invoke([&] { lh = height(pool, node->left, fork_depth - 1); },
+		[&] { rh = height(pool, node->right, fork_depth - 1); });
+	return 1 + max(lh, rh);
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::node_count(BTThreadPool& pool, BTNode<T, A>* node,
+	int fork_depth) const
+{
+	if (!node || fork_depth == 0)
+		return node_count(node);
+	int nl, nr;
+	pool.invoke([&] { nl = node_count(pool, node->left, fork_depth - 1); },
+		[&] { nr = node_count(pool, node->right, fork_depth - 1); });
+	return 1 + nl + nr;
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::leaf_count(BTThreadPool& pool, BTNode<T, A>* node,
+	int fork_depth) const
+{
+	if (!node || fork_depth == 0 || node->is_leaf())
+		return leaf_count(node);
+	int nl, nr;
+	pool.invoke([&] { nl = leaf_count(pool, node->left, fork_depth - 1); },
+		[&] { nr = leaf_count(pool, node->right, fork_depth - 1); });
+	return nl + nr;
+}
+
 /*************/
 /* Traversal */
 /*************/
 
-template<class T>
-void BinaryTree<T>::preorder(void(*f)(const T&), BTNode<T> *node) const
+template<class T, class A>
+void BinaryTree<T, A>::preorder(void(*f)(const T&), BTNode<T, A> *node) const
 {
 	if (!node)
 		return;
@@ -181,8 +442,8 @@ void BinaryTree<T>::preorder(void(*f)(const T&), BTNode<T> *node) const
 	preorder(f, node->right);
 }
 
-template<class T>
-void BinaryTree<T>::inorder(void(*f)(const T&), BTNode<T> *node) const
+template<class T, class A>
+void BinaryTree<T, A>::inorder(void(*f)(const T&), BTNode<T, A> *node) const
 {
 	if (!node)
 		return;
@@ -191,8 +452,8 @@ void BinaryTree<T>::inorder(void(*f)(const T&), BTNode<T> *node) const
 	inorder(f, node->right);
 }
 
-template<class T>
-void BinaryTree<T>::postorder(void(*f)(const T&), BTNode<T> *node) const
+template<class T, class A>
+void BinaryTree<T, A>::postorder(void(*f)(const T&), BTNode<T, A> *node) const
 {
 	if (!node)
 		return;
@@ -201,12 +462,155 @@ void BinaryTree<T>::postorder(void(*f)(const T&), BTNode<T> *node) const
 	f(node->elem);
 }
 
+/*
+ * The iterative versions below visit the nodes in exactly the same
+ * order as the recursive ones above, but keep the pending nodes in
+ * 'stack' rather than on the call stack.  At any time 'stack' holds
+ * at most one node per level of the tree.
+ */
+
+template<class T, class A>
+template<class Elem, class F>
+void BinaryTree<T, A>::walk_preorder(F& f, BTNode<T, A> *node,
+	TraversalStack& stack)
+{
+	// the stack holds the right subtrees still to be visited
+	stack.clear();
+	while (node || !stack.empty()) {
+		if (!node) {
+			node = stack.back();
+			stack.pop_back();
+		}
+		f(static_cast<Elem&>(node->elem));
+		if (node->right)
+			stack.push_back(node->right);
+		node = node->left;
+	}
+}
+
+template<class T, class A>
+template<class Elem, class F>
+void BinaryTree<T, A>::walk_inorder(F& f, BTNode<T, A> *node,
+	TraversalStack& stack)
+{
+	// the stack holds the nodes whose left subtree is being visited
+	stack.clear();
+	while (node || !stack.empty()) {
+		while (node) {
+			stack.push_back(node);
+			node = node->left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		f(static_cast<Elem&>(node->elem));
+		node = node->right;
+	}
+}
+
+template<class T, class A>
+template<class Elem, class F>
+void BinaryTree<T, A>::walk_postorder(F& f, BTNode<T, A> *node,
+	TraversalStack& stack)
+{
+	// the stack holds the path from 'node' down to the current node;
+	// 'last' is the node visited most recently, which tells whether the
+	// right subtree of the top node has been done yet
+	BTNode<T, A> *last = NULL;
+	stack.clear();
+	while (node || !stack.empty()) {
+		if (node) {
+			stack.push_back(node);
+			node = node->left;
+		}
+		else {
+			BTNode<T, A> *top = stack.back();
+			if (top->right && top->right != last)
+				node = top->right;
+			else {
+				f(static_cast<Elem&>(top->elem));
+				last = top;
+				stack.pop_back();
+			}
+		}
+	}
+}
+
+/*
+ * Morris traversals.  When the walk arrives at a node with a left
+ * subtree, the inorder predecessor of the node (the rightmost node of
+ * its left subtree) has an empty 'right' pointer.  Pointing it at the
+ * node leaves a way back up once the left subtree is done, so no stack
+ * is needed.  Finding the thread a second time means the left subtree
+ * has been visited; the thread is then removed again.
+ */
+
+template<class T, class A>
+template<class F>
+void BinaryTree<T, A>::morris_inorder(F&& f)
+{
+	BTNode<T, A> *node = root;
+	while (node) {
+		if (!node->left) {
+			f(static_cast<const T&>(node->elem));
+			node = node->right;
+			continue;
+		}
+
+		// find the predecessor, stopping at an existing thread
+		BTNode<T, A> *pred = node->left;
+		while (pred->right && pred->right != node)
+			pred = pred->right;
+
+		if (!pred->right) {
+			// first arrival: thread, then do the left subtree
+			pred->right = node;
+			node = node->left;
+		}
+		else {
+			// back through the thread: the left subtree is done
+			pred->right = NULL;
+			f(static_cast<const T&>(node->elem));
+			node = node->right;
+		}
+	}
+}
+
+template<class T, class A>
+template<class F>
+void BinaryTree<T, A>::morris_preorder(F&& f)
+// Same as 'morris_inorder', except that a node is visited on the first
+// arrival rather than when coming back through the thread
+{
+	BTNode<T, A> *node = root;
+	while (node) {
+		if (!node->left) {
+			f(static_cast<const T&>(node->elem));
+			node = node->right;
+			continue;
+		}
+
+		BTNode<T, A> *pred = node->left;
+		while (pred->right && pred->right != node)
+			pred = pred->right;
+
+		if (!pred->right) {
+			f(static_cast<const T&>(node->elem));
+			pred->right = node;
+			node = node->left;
+		}
+		else {
+			pred->right = NULL;
+			node = node->right;
+		}
+	}
+}
+
 /************************/
 /* Conversion to Arrays */
 /************************/
 
-template<class T>
-int BinaryTree<T>::to_flat_array(T *elements, int max) const
+template<class T, class A>
+int BinaryTree<T, A>::to_flat_array(T *elements, int max) const
 // PRE: This is a complete binary tree
 // Copies the elements contained in the nodes of this tree to
 // 'elements' in complete-tree order (see above).  At most
@@ -220,8 +624,8 @@ int BinaryTree<T>::to_flat_array(T *elements, int max) const
 	return to_flat_array(elements, max, root, 1, max_index);
 }
 
-template<class T>
-int BinaryTree<T>::to_flat_array(T *elements, int max, BTNode<T> *node,
+template<class T, class A>
+int BinaryTree<T, A>::to_flat_array(T *elements, int max, BTNode<T, A> *node,
 	int index, int& max_index) const
 	// PRE: this is a complete binary tree
 	// Helper function for the 'to_flat_array' function above
@@ -252,78 +656,509 @@ int BinaryTree<T>::to_flat_array(T *elements, int max, BTNode<T> *node,
 	return max_index;
 }
 
+template<class T, class A>
+BinaryTree<T, A>::BinaryTree(const vector<bool>& present,
+	const vector<T>& elements)
+// Constructs a tree from its sparse encoding (see 'init_sparse')
+{
+	root = NULL;
+	alloc = NULL;
+	own_alloc = true;
+	init_sparse(present, elements);
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::init_sparse(const vector<bool>& present,
+	const vector<T>& elements)
+// Initializes this tree from the encoding made by 'to_sparse_array'.
+// The links are filled in level order, as a queue; missing bits count
+// as absent links, and the tree stops growing when 'elements' runs out
+{
+	empty_this();
+
+	vector<BTNode<T, A>**> links(1, &root);
+	size_t n_nodes = 0;
+	for (size_t k = 0; k < links.size(); k++) {
+		if (k >= present.size() || !present[k] || n_nodes == elements.size())
+			continue;
+		BTNode<T, A> *node = new_node(elements[n_nodes++]);
+		*links[k] = node;
+		links.push_back(&node->left);
+		links.push_back(&node->right);
+	}
+
+	// the children were linked after their parents were created: update
+	// the augmented data bottom-up, i.e., in reverse level order
+	if (!is_same<A, BTNoAugment>::value) {
+		for (size_t k = links.size(); k-- > 0; ) {
+			if (*links[k])
+				A::update(*links[k]);
+		}
+	}
+}
+
+template<class T, class A>
+int BinaryTree<T, A>::to_sparse_array(vector<bool>& present,
+	vector<T>& elements) const
+// Writes the sparse encoding of this tree (see above) to 'present' and
+// 'elements', replacing their contents; returns the number of nodes.
+// Unlike 'to_flat_array', this works for any shape in O(n) space
+{
+	present.clear();
+	elements.clear();
+	present.push_back(root != NULL);
+	for (levelorder_iterator it = levelorder_begin();
+	     it != levelorder_end(); ++it) {
+		elements.push_back(*it);
+		present.push_back(it.node()->left != NULL);
+		present.push_back(it.node()->right != NULL);
+	}
+	return int(elements.size());
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::init_preorder_inorder(const vector<T>& preorder,
+	const vector<T>& inorder)
+{
+	if (preorder.size() != inorder.size()) {
+		empty_this();
+		return false;
+	}
+	int n = int(preorder.size());
+	return init_traversals(n ? &preorder[0] : NULL, n ? &inorder[0] : NULL,
+		n, 1);
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::init_postorder_inorder(const vector<T>& postorder,
+	const vector<T>& inorder)
+// A postorder sequence read backwards is a preorder with the right
+// subtrees first, which goes with the inorder sequence read backwards
+{
+	if (postorder.size() != inorder.size()) {
+		empty_this();
+		return false;
+	}
+	int n = int(postorder.size());
+	return init_traversals(n ? &postorder[n - 1] : NULL,
+		n ? &inorder[n - 1] : NULL, n, -1);
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::init_traversals(const T *order, const T *inorder,
+	int n, int step)
+// Helper for the functions above: 'order' is a preorder sequence and
+// 'inorder' the matching inorder one if 'step' is 1; with 'step' -1
+// both are read backwards and the roles of 'left' and 'right' swap.
+// The nodes are created in preorder.  The stack holds the nodes whose
+// first subtree is being built; a node is done with it when it is the
+// next node of the inorder sequence, and the next node then becomes the
+// second child of the last node popped.  The elements are matched by
+// '==' against the next inorder element only, so no search is needed.
+// The sequences belong to one tree exactly when every node gets popped
+// this way
+{
+	empty_this();
+	if (n == 0)
+		return true;
+
+	TraversalStack stack;
+	root = new_node(*order);
+	stack.push_back(root);
+	int popped = 0;
+	for (int k = 1; k < n; k++) {
+		order += step;
+		BTNode<T, A> *node = new_node(*order), *parent = NULL;
+		while (!stack.empty() && stack.back()->elem == *inorder) {
+			parent = stack.back();
+			stack.pop_back();
+			inorder += step;
+			popped++;
+		}
+		if (parent)
+			(step > 0 ? parent->right : parent->left) = node;
+		else
+			(step > 0 ? stack.back()->left : stack.back()->right) = node;
+		stack.push_back(node);
+	}
+	while (!stack.empty() && stack.back()->elem == *inorder) {
+		stack.pop_back();
+		popped++;
+		if (popped < n)
+			inorder += step;
+	}
+
+	if (popped != n) {
+		empty_this();
+		return false;
+	}
+	update_all();
+	return true;
+}
+
 /*************/
 /* Operators */
 /*************/
-template<class T>
-bool BinaryTree<T>::operator==(const BinaryTree& src) const
+template<class T, class A>
+bool BinaryTree<T, A>::operator==(const BinaryTree& src) const
+// With hashes kept in the nodes ('BTSubtreeHash') this trusts them:
+// see 'equals'
 {
 
 	if ((this->root && !src.root) || (!this->root && src.root))
 		return 0;
-	return compare(this->root, src.root);
+	return equals(src, false);
 }
 
-template<class T>
-bool BinaryTree<T>::operator!=(const BinaryTree& src) const
+template<class T, class A>
+bool BinaryTree<T, A>::equals(const BinaryTree& src, bool verify) const
+// Compares this tree with 'src'.  If the nodes keep hashes, trees with
+// different root hashes are rejected right away, and trees with equal
+// root hashes are taken to be equal unless 'verify' asks for the full
+// node-by-node comparison
+{
+	if (A::keeps_hash) {
+		if (A::cached_hash(root) != A::cached_hash(src.root))
+			return false;
+		if (!verify)
+			return true;
+	}
+	return compare(root, src.root);
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::operator!=(const BinaryTree& src) const
 {
 	return !((*this) == src);
 }
 
-template<class T>
-BinaryTree<T>& BinaryTree<T>::operator=(const BinaryTree& src)
+template<class T, class A>
+BinaryTree<T, A>& BinaryTree<T, A>::operator=(const BinaryTree& src)
+// The nodes this tree already has are reused for the copy wherever the
+// shapes of the two trees overlap; only the rest is freed or allocated
+{
+	if (this != &src)
+		root = clone_into(root, src.root);
+	return *this;
+}
+
+template<class T, class A>
+BinaryTree<T, A>& BinaryTree<T, A>::operator=(BinaryTree&& src) noexcept
+// Frees this tree, then takes over the nodes of 'src' as the move
+// constructor does
 {
-	this->root = clone(src.root);
+	if (this == &src)
+		return *this;
+	empty_this();
+	if (own_alloc)
+		delete alloc;
+	root = src.root;
+	alloc = src.alloc;
+	own_alloc = src.own_alloc;
+	src.root = NULL;
+	if (src.own_alloc)
+		src.alloc = NULL;
 	return *this;
 }
 
+/**************************************/
+/* Mutators, and other Initialization */
+/**************************************/
+
+template<class T, class A>
+bool BinaryTree<T, A>::empty_this()
+// Removes all the nodes of this tree.  If the tree has an allocator of
+// its own and the nodes (elements and augmented data) need no
+// destructor, all the storage is released at once instead of visiting
+// the nodes one by one
+{
+	if (!(own_alloc && alloc && is_trivially_destructible<BTNode<T, A> >::value
+	      && alloc->release_all()))
+		empty(root);
+	root = NULL;
+	return true;
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::empty_this(BTReclaimer& reclaimer)
+// Detaches all the nodes of this tree and leaves freeing them to the
+// background thread of 'reclaimer', so that the call returns at once.
+// This needs the tree to have an allocator of its own, which goes along
+// with the nodes (the tree starts a new one when it needs it); a tree
+// sharing its allocator is emptied right here instead
+{
+	if (!own_alloc || !alloc)
+		return empty_this();
+
+	BTNode<T, A> *node = root;
+	BTNodeAllocator<BTNode<T, A> > *node_alloc = alloc;
+	root = NULL;
+	alloc = NULL;
+	reclaimer.defer([node, node_alloc] {
+		if (!(is_trivially_destructible<BTNode<T, A> >::value
+		      && node_alloc->release_all()))
+			empty(node, node_alloc);
+		delete node_alloc;
+	});
+	return true;
+}
+
+/****************/
+/* Node Storage */
+/****************/
+
+template<class T, class A>
+BTNodeAllocator<BTNode<T, A> >* BinaryTree<T, A>::allocator()
+// Returns the node allocator of this tree, giving the tree an arena
+// of its own the first time a node is needed
+{
+	if (!alloc) {
+		alloc = new BTNodeArena<BTNode<T, A> >;
+		own_alloc = true;
+	}
+	return alloc;
+}
+
+template<class T, class A>
+BTNode<T, A>* BinaryTree<T, A>::new_node(const T& elem, BTNode<T, A> *left,
+	BTNode<T, A> *right)
+// Creates a node with the given children, whose augmented data (if
+// any) must be up to date; the data of the new node is computed here
+{
+	BTNode<T, A> *node =
+		new (allocator()->allocate()) BTNode<T, A>(elem, left, right);
+	A::update(node);
+	return node;
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::delete_node(BTNode<T, A> *node)
+{
+	node->~BTNode();
+	alloc->deallocate(node);
+}
+
 /******************/
 /* Help Functions */
 /******************/
-template<class T>
-void BinaryTree<T>::empty(BTNode<T>* node)
+template<class T, class A>
+void BinaryTree<T, A>::empty(BTNode<T, A>* node,
+	BTNodeAllocator<BTNode<T, A> > *alloc)
+// Frees every node of the subtree 'node' (which came from 'alloc')
+// without recursion or a stack: as long as the current node has a left
+// child, a right rotation moves that child up; a node without a left
+// child is freed and the walk goes on with its right child
 {
-	if (!node)
-		return;
-	else if ((*node).is_leaf())
-	{
-		delete node;
-		return;
+	while (node) {
+		BTNode<T, A> *next;
+		if (node->left) {
+			next = node->left;
+			node->left = next->right;
+			next->right = node;
+		}
+		else {
+			next = node->right;
+			node->~BTNode();
+			alloc->deallocate(node);
+		}
+		node = next;
 	}
-	else
-		return empty((*node).left), empty((*node).right);
+}
 
+template<class T, class A>
+BTNode<T, A>* BinaryTree<T, A>::clone(BTNode<T, A> *node)
+{
+	return (node ? clone(node, allocator()) : NULL);
 }
 
-template<class T>
-BTNode<T>* BinaryTree<T>::clone(BTNode<T> *node)
+template<class T, class A>
+BTNode<T, A>* BinaryTree<T, A>::clone(BTNode<T, A> *node,
+	BTNodeAllocator<BTNode<T, A> > *alloc)
+// Copies the subtree 'node', taking the new nodes from 'alloc'.  The
+// copies are made in preorder, without recursion: the stack holds the
+// subtrees still to be copied, with the links their copies go to.  If
+// an allocation throws, the part copied so far is freed again
 {
-	if (!node)
-		return NULL;
-	BTNode<T>* temp;
-	temp = new BTNode<T>;
-	temp->elem = node->elem;
-	temp->left = clone(node->left);//ݹcloneĸ
-	temp->right = clone(node->right);
-	return temp;
+	BTNode<T, A> *copy = NULL;
+	vector<pair<BTNode<T, A>*, BTNode<T, A>**> > stack;
+	vector<BTNode<T, A>*> made;  // the copies in preorder, for 'A::update'
+	if (node)
+		stack.push_back(make_pair(node, &copy));
+	try {
+		while (!stack.empty()) {
+			BTNode<T, A> *src = stack.back().first;
+			BTNode<T, A> **link = stack.back().second;
+			stack.pop_back();
+			BTNode<T, A> *temp =
+				new (alloc->allocate()) BTNode<T, A>(src->elem);
+			*link = temp;
+			if (src->right)
+				stack.push_back(make_pair(src->right, &temp->right));
+			if (src->left)
+				stack.push_back(make_pair(src->left, &temp->left));
+			if (!is_same<A, BTNoAugment>::value)
+				made.push_back(temp);
+		}
+	}
+	catch (...) {
+		empty(copy, alloc);
+		throw;
+	}
+
+	// the augmented data goes bottom-up, i.e., in reverse preorder
+	for (size_t k = made.size(); k-- > 0; )
+		A::update(made[k]);
+	return copy;
 }
 
-template<class T>
-bool BinaryTree<T>::compare(BTNode<T> *a, BTNode<T> *b) const
+template<class T, class A>
+BTNode<T, A>* BinaryTree<T, A>::clone_into(BTNode<T, A> *node,
+	BTNode<T, A> *src)
+// Turns the subtree 'node' into a copy of the subtree 'src' and returns
+// its root: nodes present in both shapes are overwritten in place,
+// surplus ones are freed and missing ones cloned.  The stack holds the
+// links still to be done, with the subtrees of 'src' they must copy.
+// If cloning throws, the augmented data is still brought up to date
 {
-	if (!a && !b)
-		return 1;
-	if (a && b && a->elem == b->elem)
-		return compare(a->left, b->left) && compare(a->right, b->right);// ݹcompareɶıȽ
-	else
-		return 0;
+	vector<pair<BTNode<T, A>**, BTNode<T, A>*> > stack(1,
+		make_pair(&node, src));
+	vector<BTNode<T, A>*> reused;  // in preorder, for 'A::update'
+	try {
+		while (!stack.empty()) {
+			BTNode<T, A> **link = stack.back().first;
+			src = stack.back().second;
+			stack.pop_back();
+			if (!src) {
+				empty(*link);
+				*link = NULL;
+			}
+			else if (!*link)
+				*link = clone(src);
+			else {
+				(*link)->elem = src->elem;
+				if (!is_same<A, BTNoAugment>::value)
+					reused.push_back(*link);
+				stack.push_back(make_pair(&(*link)->right, src->right));
+				stack.push_back(make_pair(&(*link)->left, src->left));
+			}
+		}
+	}
+	catch (...) {
+		for (size_t k = reused.size(); k-- > 0; )
+			A::update(reused[k]);
+		throw;
+	}
+
+	for (size_t k = reused.size(); k-- > 0; )
+		A::update(reused[k]);
+	return node;
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::compare(BTNode<T, A> *a, BTNode<T, A> *b) const
+// The pairs of subtrees still to be compared wait on an explicit stack,
+// so that no depth overflows the call stack
+{
+	vector<pair<BTNode<T, A>*, BTNode<T, A>*> > stack(1, make_pair(a, b));
+	while (!stack.empty()) {
+		a = stack.back().first;
+		b = stack.back().second;
+		stack.pop_back();
+		if (!a && !b)
+			continue;
+		// subtrees with different hashes cannot be equal
+		if (A::keeps_hash && A::cached_hash(a) != A::cached_hash(b))
+			return 0;
+		if (!a || !b || !(a->elem == b->elem))
+			return 0;
+		stack.push_back(make_pair(a->right, b->right));
+		stack.push_back(make_pair(a->left, b->left));
+	}
+	return 1;
 }
+template<class T, class A>
+size_t BinaryTree<T, A>::hash(BTNode<T, A>* node) const
+// A hash of the subtree 'node' (its elements and its shape): the one
+// kept in the node if there is one, else computed the same way
+// The walk is the one of 'walk_postorder'; the hashes of the finished
+// subtrees are kept on a stack of their own, and a node takes the ones
+// on top, which belong to its children (the right one last)
+{
+	if (A::keeps_hash)
+		return A::cached_hash(node);
+	TraversalStack stack;
+	vector<size_t> hashes;
+	BTNode<T, A> *last = NULL;
+	while (node || !stack.empty()) {
+		if (node) {
+			stack.push_back(node);
+			node = node->left;
+			continue;
+		}
+		BTNode<T, A> *top = stack.back();
+		if (top->right && top->right != last) {
+			node = top->right;
+			continue;
+		}
+		size_t right = BTSubtreeHash::empty_hash();
+		size_t left = BTSubtreeHash::empty_hash();
+		if (top->right) {
+			right = hashes.back();
+			hashes.pop_back();
+		}
+		if (top->left) {
+			left = hashes.back();
+			hashes.pop_back();
+		}
+		hashes.push_back(BTSubtreeHash::node_hash(top->elem, left, right));
+		last = top;
+		stack.pop_back();
+	}
+	return (hashes.empty() ? BTSubtreeHash::empty_hash() : hashes.back());
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::elements_changed()
+// Called after elements have been modified in place: brings any data
+// of the augmentation that depends on the elements up to date
+{
+	if (A::uses_elem)
+		update_all();
+}
+
+template<class T, class A>
+void BinaryTree<T, A>::update_all()
+// Brings the data of the augmentation up to date in every node, by a
+// postorder walk over the nodes
+{
+	if (is_same<A, BTNoAugment>::value)
+		return;
+	TraversalStack stack;
+	BTNode<T, A> *node = root, *last = NULL;
+	while (node || !stack.empty()) {
+		if (node) {
+			stack.push_back(node);
+			node = node->left;
+		}
+		else {
+			BTNode<T, A> *top = stack.back();
+			if (top->right && top->right != last)
+				node = top->right;
+			else {
+				A::update(top);
+				last = top;
+				stack.pop_back();
+			}
+		}
+	}
+}
+
 /**************************/
 /* Input/Output Operators */
 /**************************/
 
-template<class T>
-ostream& operator<<(ostream& out, const BinaryTree<T>& src)
+template<class T, class A>
+ostream& operator<<(ostream& out, const BinaryTree<T, A>& src)
 // Writes the elements contained in the nodes of this tree,
 // by way of an inorder traversal
 {
@@ -332,8 +1167,8 @@ ostream& operator<<(ostream& out, const BinaryTree<T>& src)
 	return out;
 }
 
-template<class T>
-ostream& operator<<(ostream& out, const BTNode<T>* node)
+template<class T, class A>
+ostream& operator<<(ostream& out, const BTNode<T, A>* node)
 // Helper for the 'operator<<' above
 {
 	// don't write a NULL node
@@ -349,6 +1184,128 @@ ostream& operator<<(ostream& out, const BTNode<T>* node)
 	return out;
 }
 
+/******************/
+/* Binary Streams */
+/******************/
+
+template<class T, class A>
+bool BinaryTree<T, A>::read_complete(istream& in, size_t chunk_bytes)
+// Replaces this tree by the complete tree whose elements are read from
+// 'in'.  Node 'i' (in complete-tree order) becomes a child of node
+// 'i/2', so the parents are taken one after the other in level order;
+// 'path' holds the nodes from the root down to the current parent 'p'.
+// Going from 'p' to 'p + 1' only changes the path below the lowest 0
+// bit of 'p', which makes it O(1) amortized
+{
+	static_assert(is_trivially_copyable<T>::value,
+		"read_complete needs a trivially copyable element type");
+	empty_this();
+	BTChunkReader reader(in, chunk_bytes);
+	T elem;
+	if (!reader.read(elem))
+		return !reader.is_truncated();
+	root = new_node(elem);
+
+	vector<BTNode<T, A>*> path(1, root);
+	int p = 1;
+	bool left_next = true;
+	while (reader.read(elem)) {
+		BTNode<T, A> *node = new_node(elem);
+		if (left_next) {
+			path.back()->left = node;
+			left_next = false;
+			continue;
+		}
+		path.back()->right = node;
+		left_next = true;
+
+		// move on to the next parent: 't' trailing 1 bits of 'p' become
+		// 0 and the bit above them becomes 1
+		int t = 0;
+		while ((p >> t) & 1)
+			t++;
+		p++;
+		if ((p & (p - 1)) == 0) {
+			// first node of the next level: the leftmost path
+			size_t depth = path.size() + 1;
+			path.resize(1);
+			while (path.size() < depth)
+				path.push_back(path.back()->left);
+		}
+		else {
+			path.resize(path.size() - (t + 1));
+			path.push_back(path.back()->right);
+			for (int k = 0; k < t; k++)
+				path.push_back(path.back()->left);
+		}
+	}
+	update_all();
+	return !reader.is_truncated();
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::read_preorder(istream& in, size_t chunk_bytes)
+// Replaces this tree by the one read from 'in' in the preorder format.
+// 'pending' holds the links still to be filled; the right links wait
+// there while the left subtrees are read, so it grows with the height
+// of the tree only.  The stream is left just after the tree if it can
+// seek (see 'BTChunkReader::give_back')
+{
+	static_assert(is_trivially_copyable<T>::value,
+		"read_preorder needs a trivially copyable element type");
+	empty_this();
+	BTChunkReader reader(in, chunk_bytes);
+	vector<BTNode<T, A>**> pending(1, &root);
+	unsigned char flags;
+	T elem;
+
+	while (!pending.empty()) {
+		if (!reader.read(flags)) {
+			update_all();
+			// an empty stream is an empty tree
+			return root == NULL && !reader.is_truncated();
+		}
+		if (!reader.read(elem)) {
+			// a flag byte without its element
+			update_all();
+			return false;
+		}
+		BTNode<T, A> **link = pending.back();
+		pending.pop_back();
+		*link = new_node(elem);
+		if (flags & 2)
+			pending.push_back(&(*link)->right);
+		if (flags & 1)
+			pending.push_back(&(*link)->left);
+	}
+	update_all();
+	// the format marks its own end: whatever follows belongs to the caller
+	reader.give_back();
+	return true;
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::write_complete(ostream& out) const
+// PRE: This is a complete binary tree
+{
+	for (levelorder_iterator it = levelorder_begin();
+	     it != levelorder_end(); ++it)
+		out.write((const char*) &*it, sizeof(T));
+	return !out.fail();
+}
+
+template<class T, class A>
+bool BinaryTree<T, A>::write_preorder(ostream& out) const
+{
+	for (preorder_iterator it = preorder_begin(); it != preorder_end(); ++it) {
+		unsigned char flags = (it.node()->left ? 1 : 0)
+			| (it.node()->right ? 2 : 0);
+		out.write((const char*) &flags, 1);
+		out.write((const char*) &*it, sizeof(T));
+	}
+	return !out.fail();
+}
+
 /***********/
 /* Display */
 /***********/
@@ -359,8 +1316,8 @@ static const double node_sep = 30;
 static const double node_box_margin = 6;
 static const double node_box_r = 6;
 
-template<class T>
-void BinaryTree<T>::display( PDF *pdf, const string& annotation ) const
+template<class T, class A>
+void BinaryTree<T, A>::display( PDF *pdf, const string& annotation ) const
 {
   double scale = 1;
 
@@ -387,8 +1344,8 @@ void BinaryTree<T>::display( PDF *pdf, const string& annotation ) const
   display(pdf, root, h - 1, x, y, scale);
 }
 
-template<class T>
-void BinaryTree<T>::display( PDF *pdf, BTNode<T> *node, int leaf_dist,
+template<class T, class A>
+void BinaryTree<T, A>::display( PDF *pdf, BTNode<T, A> *node, int leaf_dist,
 	         double x, double y, double scale ) const
 {
   // don't draw a NULL node
@@ -3,14 +3,25 @@
 
 #include <iostream>
 #include <sstream>
+#include <type_traits>
+#include <vector>
 
 #include "PDF.cc" // for the PDF display
+#include "BTAugment.h"
+#include "BTNodeAllocator.h"
+#include "BTIterator.h"
+#include "BTThreadPool.h"
+#include "BTReclaimer.h"
+#include "BTChunkReader.h"
 
 using namespace std;
 
-/* A lightweight structure implementing a general binary tree node */
-template <class T>
-struct BTNode {
+/* A lightweight structure implementing a general binary tree node;
+ * the augmentation policy 'A' may add data to it (see "BTAugment.h") */
+template <class T, class A = BTNoAugment>
+struct BTNode : public A {
+  typedef T value_type;
+
   T       elem;  // element contained in the node
   BTNode *left;  // pointer to the left child (can be NULL)
   BTNode *right; // pointer to the right child (can be NULL)
@@ -42,74 +53,250 @@ struct BTNode {
 /* A 'BinaryTree' class implements a basic binary tree.  It serves
  * as a superclass for more specific types of binary trees, such as
  * a binary search tree.
+ *
+ * The nodes are of type 'BTNode<T, A>'; with an augmentation policy
+ * such as 'BTSubtreeStats' the tree keeps the extra data of every node
+ * up to date, and the accessors use it where they can.
  */
 
-template <class T>
+template <class T, class A = BTNoAugment>
 class BinaryTree {
  public:
 
   /* Construction */
-  BinaryTree() { root = NULL; }
+  BinaryTree() { root = NULL; alloc = NULL; own_alloc = true; }
+  explicit BinaryTree( BTNodeAllocator<BTNode<T, A> > *alloc,
+                       bool own_alloc = false );
   BinaryTree( T *elements, int n_elements );
+  BinaryTree( const vector<bool>& present, const vector<T>& elements );
   BinaryTree( const BinaryTree& src );
-  ~BinaryTree() { empty_this(); }
+  BinaryTree( const BinaryTree& src, BTThreadPool& pool,
+              int fork_depth = -1 );
+  BinaryTree( BinaryTree&& src ) noexcept;
+  ~BinaryTree();
 
   /* Access and Tests */
   bool is_empty() const;
   int height() const         { return height(root); }
   int node_count() const     { return node_count(root); }
   int leaf_count() const     { return leaf_count(root); }
+  const T& select( int k ) const;
+  size_t hash() const        { return hash(root); }
+
+  /* Parallel versions of the above: subtrees rooted less than
+   * 'fork_depth' levels below the root are handed to the threads of
+   * 'pool', deeper ones are walked serially.  This is the grain of the
+   * computation; by default 'pool.default_fork_depth()' is used. */
+  int height( BTThreadPool& pool, int fork_depth = -1 ) const;
+  int node_count( BTThreadPool& pool, int fork_depth = -1 ) const;
+  int leaf_count( BTThreadPool& pool, int fork_depth = -1 ) const;
 
   /* Mutators, and other Initialization */
-  bool empty_this() { empty(root); root = NULL; return true; }
+  bool empty_this();
+  bool empty_this( BTReclaimer& reclaimer );
   void init_complete( T *elements, int n_elements );
   int to_flat_array( T* elements, int max ) const;
 
-  /* Traversal */
-  void preorder( void (*f)(const T&) )  const { return preorder(f, root); }
-  void inorder( void (*f)(const T&) )   const { return inorder(f, root); }
-  void postorder( void (*f)(const T&) ) const { return postorder(f, root); }
+  /* Sparse level-order encoding, for trees of any shape: 'present' has
+   * one bit per link in level order (the root link first, then the two
+   * child links of every node), and 'elements' has the elements of the
+   * nodes in level order.  A tree of n nodes takes 2n + 1 bits and n
+   * elements, however deep it is. */
+  void init_sparse( const vector<bool>& present, const vector<T>& elements );
+  int to_sparse_array( vector<bool>& present, vector<T>& elements ) const;
+
+  /* Rebuilds the tree of any shape that has the given traversal
+   * sequences, in O(n) time and O(height) extra memory; the elements
+   * must be distinct.  Returns false, leaving the tree empty, if the
+   * sequences do not belong to one tree. */
+  bool init_preorder_inorder( const vector<T>& preorder,
+                              const vector<T>& inorder );
+  bool init_postorder_inorder( const vector<T>& postorder,
+                               const vector<T>& inorder );
+
+  /* Traversal
+   * The traversals are iterative, so they work for trees of any depth.
+   * The explicit stack they use only grows to the height of the tree;
+   * passing the same 'TraversalStack' to several traversals reuses
+   * its buffer instead of allocating a new one each time.
+   *
+   * Besides plain functions, 'f' may be any callable taking a 'const T&'
+   * (a lambda or function object, which may carry state); the call is
+   * then visible to the compiler and can be inlined into the loop.
+   * The '_mutable' versions pass each element as a 'T&' instead. */
+  typedef vector<BTNode<T, A>*> TraversalStack;
+
+  void preorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_preorder<const T>(f, root, stack); }
+  void inorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_inorder<const T>(f, root, stack); }
+  void postorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_postorder<const T>(f, root, stack); }
+  void preorder( void (*f)(const T&), TraversalStack& stack ) const
+    { walk_preorder<const T>(f, root, stack); }
+  void inorder( void (*f)(const T&), TraversalStack& stack ) const
+    { walk_inorder<const T>(f, root, stack); }
+  void postorder( void (*f)(const T&), TraversalStack& stack ) const
+    { walk_postorder<const T>(f, root, stack); }
+
+  template<class F> void preorder( F&& f ) const
+    { TraversalStack stack; walk_preorder<const T>(f, root, stack); }
+  template<class F> void inorder( F&& f ) const
+    { TraversalStack stack; walk_inorder<const T>(f, root, stack); }
+  template<class F> void postorder( F&& f ) const
+    { TraversalStack stack; walk_postorder<const T>(f, root, stack); }
+  template<class F> void preorder( F&& f, TraversalStack& stack ) const
+    { walk_preorder<const T>(f, root, stack); }
+  template<class F> void inorder( F&& f, TraversalStack& stack ) const
+    { walk_inorder<const T>(f, root, stack); }
+  template<class F> void postorder( F&& f, TraversalStack& stack ) const
+    { walk_postorder<const T>(f, root, stack); }
+
+  template<class F> void preorder_mutable( F&& f )
+    { TraversalStack s; walk_preorder<T>(f, root, s); elements_changed(); }
+  template<class F> void inorder_mutable( F&& f )
+    { TraversalStack s; walk_inorder<T>(f, root, s); elements_changed(); }
+  template<class F> void postorder_mutable( F&& f )
+    { TraversalStack s; walk_postorder<T>(f, root, s); elements_changed(); }
+
+  /* Morris traversals: inorder and preorder in O(1) extra memory, by
+   * temporarily threading empty 'right' pointers back to the successor
+   * node.  Every thread is removed again before they return, so the tree
+   * ends up unchanged, but while they run the tree is being modified:
+   * they must not run concurrently with any other access to the tree,
+   * and 'f' must neither throw nor look at the tree itself. */
+  template<class F> void morris_inorder( F&& f );
+  template<class F> void morris_preorder( F&& f );
+
+  /* Iterators
+   * Forward iterators over the elements in each traversal order; plain
+   * 'begin()'/'end()' walk the tree inorder */
+  typedef BTIterator<BTNode<T, A>, BTInorder> iterator;
+  typedef BTIterator<BTNode<T, A>, BTInorder> const_iterator;
+  typedef BTIterator<BTNode<T, A>, BTPreorder> preorder_iterator;
+  typedef BTIterator<BTNode<T, A>, BTInorder> inorder_iterator;
+  typedef BTIterator<BTNode<T, A>, BTPostorder> postorder_iterator;
+  typedef BTLevelIterator<BTNode<T, A> > levelorder_iterator;
+
+  iterator begin() const { return iterator(root); }
+  iterator end() const   { return iterator(); }
+  preorder_iterator preorder_begin() const
+    { return preorder_iterator(root); }
+  preorder_iterator preorder_end() const { return preorder_iterator(); }
+  inorder_iterator inorder_begin() const
+    { return inorder_iterator(root); }
+  inorder_iterator inorder_end() const { return inorder_iterator(); }
+  postorder_iterator postorder_begin() const
+    { return postorder_iterator(root); }
+  postorder_iterator postorder_end() const { return postorder_iterator(); }
+  levelorder_iterator levelorder_begin() const
+    { return levelorder_iterator(root); }
+  levelorder_iterator levelorder_end() const { return levelorder_iterator(); }
 
   /* Operators */
   bool operator==( const BinaryTree& src ) const;
   bool operator!=( const BinaryTree& src ) const;
-  BinaryTree<T>& operator=(const BinaryTree& src);
+  bool equals( const BinaryTree& src, bool verify ) const;
+  BinaryTree& operator=(const BinaryTree& src);
+  BinaryTree& operator=(BinaryTree&& src) noexcept;
 
   /* Input/Output */
-  template<class S>
-  friend ostream& operator<<( ostream& out, const BinaryTree<S>& src );
+  template<class S, class B>
+  friend ostream& operator<<( ostream& out, const BinaryTree<S, B>& src );
+
+  /* Binary streams, for trivially copyable elements.  The readers build
+   * the tree while the stream is being read, in chunks of 'chunk_bytes',
+   * so that besides the nodes they only need memory for one chunk and
+   * O(height) pointers; they return false if the stream ends inside a
+   * record, keeping the nodes read so far.
+   *   complete: the elements in complete-tree order (the tree must be
+   *             complete when it is written);
+   *   preorder: for every node in preorder a flag byte (1 if it has a
+   *             left child, 2 if it has a right child, or both) and the
+   *             element.  The format marks its own end, and a seekable
+   *             stream is left just after the tree (see "BTChunkReader.h"). */
+  bool read_complete( istream& in, size_t chunk_bytes = 1 << 16 );
+  bool read_preorder( istream& in, size_t chunk_bytes = 1 << 16 );
+  bool write_complete( ostream& out ) const;
+  bool write_preorder( ostream& out ) const;
 
   /* Display */
   void display( PDF* pdf, const string& annotation = "" ) const;
 
 
  protected:
-  BTNode<T> *root;  // Root node (NULL if the tree is empty)
+  BTNode<T, A> *root;  // Root node (NULL if the tree is empty)
+
+  /* Node storage: every node of this tree comes from 'alloc'.  If
+   * 'own_alloc' is set the allocator belongs to this tree alone (and is
+   * created as a 'BTNodeArena' on first use when 'alloc' is NULL) */
+  BTNodeAllocator<BTNode<T, A> > *alloc;
+  bool own_alloc;
+
+  BTNodeAllocator<BTNode<T, A> > *allocator();
+  BTNode<T, A> *new_node( const T& elem, BTNode<T, A> *left = NULL,
+                       BTNode<T, A> *right = NULL );
+  void delete_node( BTNode<T, A> *node );
 
   /* "Helper" functions for the basic operations */
-  BTNode<T> *clone( BTNode<T> *node );
-  bool compare(BTNode<T> *a, BTNode<T> *b) const;
+  BTNode<T, A> *clone( BTNode<T, A> *node );
+  static BTNode<T, A> *clone( BTNode<T, A> *node,
+                              BTNodeAllocator<BTNode<T, A> > *alloc );
+  BTNode<T, A> *clone_into( BTNode<T, A> *node, BTNode<T, A> *src );
+  bool compare(BTNode<T, A> *a, BTNode<T, A> *b) const;
+  size_t hash( BTNode<T, A>* node ) const;
+  void elements_changed();
+  void update_all();
+
+  /* Parallel cloning: a subtree of the source, the link to set to its
+   * copy, and the allocator the copy is taken from */
+  struct ClonePiece {
+    BTNode<T, A> *src;
+    BTNode<T, A> **dest;
+    BTNodeAllocator<BTNode<T, A> > *alloc;
+  };
+  void clone_top( BTNode<T, A> *src, BTNode<T, A> **dest, int depth,
+                  vector<ClonePiece>& pieces );
+  static void clone_pieces( BTThreadPool& pool, vector<ClonePiece>& pieces,
+                            int lo, int hi );
+  static void update_top( BTNode<T, A> *node, int depth );
+
+  int height( BTNode<T, A>* node ) const;
+  int balance_factor( BTNode<T, A>* node ) const;
+  int node_count( BTNode<T, A>* node ) const;
+  int leaf_count( BTNode<T, A>* node ) const;
+
+  int height( BTThreadPool& pool, BTNode<T, A>* node, int fork_depth ) const;
+  int node_count( BTThreadPool& pool, BTNode<T, A>* node, int fork_depth ) const;
+  int leaf_count( BTThreadPool& pool, BTNode<T, A>* node, int fork_depth ) const;
 
-  int height( BTNode<T>* node ) const;
-  int balance_factor( BTNode<T>* node ) const;
-  int node_count( BTNode<T>* node ) const;
-  int leaf_count( BTNode<T>* node ) const;
+  void preorder( void (*f)(const T&), BTNode<T, A> *node ) const;
+  void inorder( void (*f)(const T&), BTNode<T, A> *node ) const;
+  void postorder( void (*f)(const T&), BTNode<T, A> *node ) const;
 
-  void preorder( void (*f)(const T&), BTNode<T> *node ) const;
-  void inorder( void (*f)(const T&), BTNode<T> *node ) const;
-  void postorder( void (*f)(const T&), BTNode<T> *node ) const;
+  /* Iterative traversal engine; each element is passed to 'f' as an
+   * 'Elem&', where 'Elem' is either 'const T' or 'T' */
+  template<class Elem, class F>
+  static void walk_preorder( F& f, BTNode<T, A> *node, TraversalStack& stack );
+  template<class Elem, class F>
+  static void walk_inorder( F& f, BTNode<T, A> *node, TraversalStack& stack );
+  template<class Elem, class F>
+  static void walk_postorder( F& f, BTNode<T, A> *node, TraversalStack& stack );
 
-  void empty( BTNode<T>* node );
+  void empty( BTNode<T, A>* node ) { empty(node, alloc); }
+  static void empty( BTNode<T, A>* node,
+                     BTNodeAllocator<BTNode<T, A> > *alloc );
 
-  BTNode<T>* init_complete( T *elements, int n_elements, int index );
+  BTNode<T, A>* init_complete( T *elements, int n_elements, int index );
+  bool init_traversals( const T *order, const T *inorder, int n, int step );
 
-  int to_flat_array( T *elements, int max, BTNode<T> *node, int index,
+  int to_flat_array( T *elements, int max, BTNode<T, A> *node, int index,
                      int& max_index ) const;
-  void display( PDF *pdf, BTNode<T>* node, int leaf_dist,
+  void display( PDF *pdf, BTNode<T, A>* node, int leaf_dist,
 	double x, double y, double scale ) const;
 
-  template<class S>
-  friend ostream& operator<<( ostream& out, const BTNode<S>& src );
+  template<class S, class B>
+  friend ostream& operator<<( ostream& out, const BTNode<S, B>& src );
 
 };
 
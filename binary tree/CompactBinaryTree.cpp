@@ -0,0 +1,332 @@
+//#include "CompactBinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                 Implementation of CompactBinaryTree                  ***/
+/****************************************************************************/
+
+/****************/
+/* Construction */
+/****************/
+
+template<class T>
+CompactBinaryTree<T>::CompactBinaryTree(T *elements, int n_elements)
+	: pool(1), root(0), free_list(0)
+// Constructs a complete tree from 'elements[1]' ... 'elements[n_elements]'
+// (see 'BinaryTree::init_complete')
+{
+	init_complete(elements, n_elements);
+}
+
+template<class T>
+CompactBinaryTree<T>::CompactBinaryTree(const vector<bool>& present,
+	const vector<T>& elements)
+	: pool(1), root(0), free_list(0)
+// Constructs a tree from its sparse encoding (see 'init_sparse')
+{
+	init_sparse(present, elements);
+}
+
+template<class T>
+template<class A>
+CompactBinaryTree<T>::CompactBinaryTree(const BinaryTree<T, A>& src)
+	: pool(1), root(0), free_list(0)
+{
+	vector<bool> present;
+	vector<T> elements;
+	src.to_sparse_array(present, elements);
+	init_sparse(present, elements);
+}
+
+template<class T>
+CompactBinaryTree<T>::CompactBinaryTree(const CompactBinaryTree& src)
+	: pool(src.pool), root(src.root), free_list(src.free_list)
+// Handles are indices, so a copy of the pool is a copy of the tree
+{
+}
+
+template<class T>
+CompactBinaryTree<T>::CompactBinaryTree(CompactBinaryTree&& src) noexcept
+	: root(src.root), free_list(src.free_list)
+// 'src' is left with no pool at all, which needs no allocation; it is
+// an empty tree, and 'new_node' sets cell 0 aside again when it is used
+{
+	pool.swap(src.pool);
+	src.root = src.free_list = 0;
+}
+
+/****************/
+/* Node handles */
+/****************/
+
+template<class T>
+typename CompactBinaryTree<T>::Handle
+CompactBinaryTree<T>::new_node(const T& elem, Handle left, Handle right)
+// Takes the first cell of the free list, or else a new one at the end
+// of the pool
+{
+	if (pool.empty())
+		pool.push_back(Node());  // a moved-from tree has no cell 0 yet
+	Handle node = free_list;
+	if (node) {
+		free_list = pool[node].left;
+		pool[node] = Node(elem, left, right);
+	} else {
+		node = Handle(pool.size());
+		pool.push_back(Node(elem, left, right));
+	}
+	return node;
+}
+
+template<class T>
+void CompactBinaryTree<T>::delete_subtree(Handle node)
+// Puts every node of the subtree on the free list.  A node is linked
+// into the list once its children have been taken, so the list can use
+// the same 'left' field the walk reads
+{
+	TraversalStack stack;
+	if (node)
+		stack.push_back(node);
+	while (!stack.empty()) {
+		Handle k = stack.back();
+		stack.pop_back();
+		if (pool[k].left)
+			stack.push_back(pool[k].left);
+		if (pool[k].right)
+			stack.push_back(pool[k].right);
+		pool[k].right = 0;
+		pool[k].left = free_list;
+		free_list = k;
+	}
+}
+
+/********************/
+/* Access and Tests */
+/********************/
+
+template<class T>
+int CompactBinaryTree<T>::height() const
+{
+	return BTIndexWalk::height(*this);
+}
+
+template<class T>
+int CompactBinaryTree<T>::node_count() const
+{
+	return BTIndexWalk::node_count(*this);
+}
+
+template<class T>
+int CompactBinaryTree<T>::leaf_count() const
+{
+	return BTIndexWalk::leaf_count(*this);
+}
+
+template<class T>
+size_t CompactBinaryTree<T>::hash() const
+// The same hash as 'BinaryTree::hash', for a tree of the same shape and
+// elements
+{
+	return BTIndexWalk::hash(*this);
+}
+
+/**************************************/
+/* Mutators, and other Initialization */
+/**************************************/
+
+template<class T>
+bool CompactBinaryTree<T>::empty_this()
+// Frees the whole pool at once, free cells included
+{
+	vector<Node>(1).swap(pool);
+	root = free_list = 0;
+	return true;
+}
+
+template<class T>
+void CompactBinaryTree<T>::init_complete(T *elements, int n_elements)
+// Complete-tree index 'i' is pool index 'i', so the children of a node
+// follow from its index, and no recursion is needed
+{
+	empty_this();
+	if (n_elements <= 0)
+		return;
+	pool.reserve(size_t(n_elements) + 1);
+	for (uint32_t i = 1; i <= uint32_t(n_elements); i++) {
+		uint32_t left = 2 * i, right = 2 * i + 1;
+		pool.push_back(Node(elements[i],
+			left <= uint32_t(n_elements) ? left : 0,
+			right <= uint32_t(n_elements) ? right : 0));
+	}
+	root = 1;
+}
+
+template<class T>
+int CompactBinaryTree<T>::to_flat_array(T *elements, int max) const
+// PRE: This is a complete binary tree
+{
+	return BTIndexWalk::to_flat_array(*this, elements, max);
+}
+
+template<class T>
+void CompactBinaryTree<T>::init_sparse(const vector<bool>& present,
+	const vector<T>& elements)
+// Same as 'BinaryTree::init_sparse'.  In level order, the children of
+// the nodes come in the same order as the nodes themselves, so the
+// node of link 'k' is the next one to be added to the pool
+{
+	empty_this();
+	pool.reserve(elements.size() + 1);
+	size_t n_links = 1;  // links known so far: the root link, and two per node
+	for (size_t k = 0; k < n_links; k++) {
+		if (k >= present.size() || !present[k]
+		    || pool.size() - 1 == elements.size())
+			continue;
+		Handle node = Handle(pool.size());
+		pool.push_back(Node(elements[node - 1]));
+		if (k == 0)
+			root = node;
+		else if (k % 2)
+			pool[(k + 1) / 2].left = node;
+		else
+			pool[k / 2].right = node;
+		n_links += 2;
+	}
+}
+
+template<class T>
+int CompactBinaryTree<T>::to_sparse_array(vector<bool>& present,
+	vector<T>& elements) const
+{
+	return BTIndexWalk::to_sparse_array(*this, present, elements);
+}
+
+template<class T>
+template<class A>
+void CompactBinaryTree<T>::to_binary_tree(BinaryTree<T, A>& dest) const
+{
+	vector<bool> present;
+	vector<T> elements;
+	to_sparse_array(present, elements);
+	dest.init_sparse(present, elements);
+}
+
+/*************/
+/* Traversal */
+/*************/
+
+/*
+ * The walks themselves are those of 'BTIndexWalk'; they pass handles,
+ * which are turned into elements here.  The mutable traversals only
+ * change elements, never links, so the pool is taken as non-constant
+ * for them alone.
+ */
+
+template<class T>
+template<class Elem, class F>
+void CompactBinaryTree<T>::walk_preorder(F& f, TraversalStack& stack) const
+{
+	Node *nodes = const_cast<Node*>(pool.data());
+	auto visit = [&f, nodes](Handle k) {
+		f(static_cast<Elem&>(nodes[k].elem));
+	};
+	BTIndexWalk::preorder(*this, visit, stack);
+}
+
+template<class T>
+template<class Elem, class F>
+void CompactBinaryTree<T>::walk_inorder(F& f, TraversalStack& stack) const
+{
+	Node *nodes = const_cast<Node*>(pool.data());
+	auto visit = [&f, nodes](Handle k) {
+		f(static_cast<Elem&>(nodes[k].elem));
+	};
+	BTIndexWalk::inorder(*this, visit, stack);
+}
+
+template<class T>
+template<class Elem, class F>
+void CompactBinaryTree<T>::walk_postorder(F& f, TraversalStack& stack) const
+{
+	Node *nodes = const_cast<Node*>(pool.data());
+	auto visit = [&f, nodes](Handle k) {
+		f(static_cast<Elem&>(nodes[k].elem));
+	};
+	BTIndexWalk::postorder(*this, visit, stack);
+}
+
+/*************/
+/* Operators */
+/*************/
+
+template<class T>
+bool CompactBinaryTree<T>::operator==(const CompactBinaryTree& src) const
+{
+	return BTIndexWalk::equal(*this, src);
+}
+
+template<class T>
+CompactBinaryTree<T>&
+CompactBinaryTree<T>::operator=(const CompactBinaryTree& src)
+{
+	pool = src.pool;
+	root = src.root;
+	free_list = src.free_list;
+	return *this;
+}
+
+template<class T>
+CompactBinaryTree<T>&
+CompactBinaryTree<T>::operator=(CompactBinaryTree&& src) noexcept
+{
+	if (this != &src) {
+		pool.swap(src.pool);
+		vector<Node>().swap(src.pool);
+		root = src.root;
+		free_list = src.free_list;
+		src.root = src.free_list = 0;
+	}
+	return *this;
+}
+
+/****************/
+/* Input/Output */
+/****************/
+
+template<class T>
+ostream& operator<<(ostream& out, const CompactBinaryTree<T>& src)
+// Writes the elements by way of an inorder traversal
+{
+	BTIndexWalk::write(out, src);
+	return out;
+}
+
+/****************************************************************************/
+/***            Implementation of CompactBinaryTree::iterator             ***/
+/****************************************************************************/
+
+template<class T>
+typename CompactBinaryTree<T>::iterator&
+CompactBinaryTree<T>::iterator::operator++()
+// The next node is the top of the stack; its right subtree is walked
+// after it
+{
+	if (stack.empty()) {
+		cur = 0;
+		return *this;
+	}
+	cur = stack.top();
+	stack.pop();
+	push_left_path(pool[cur].right);
+	return *this;
+}
+
+template<class T>
+void CompactBinaryTree<T>::iterator::push_left_path(Handle node)
+{
+	while (node) {
+		stack.push(node);
+		node = pool[node].left;
+	}
+}
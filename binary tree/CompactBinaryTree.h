@@ -0,0 +1,221 @@
+#ifndef __CompactBinaryTree_H
+#define __CompactBinaryTree_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "BTIndexWalk.h"
+
+using namespace std;
+
+/* A node of a 'CompactBinaryTree': the children are 32-bit indices into
+ * the node pool of the tree, with 0 for no child, instead of pointers.
+ * With 4-byte elements a node takes 12 bytes rather than 24. */
+template <class T>
+struct BTCompactNode {
+  typedef T value_type;
+
+  T        elem;   // element contained in the node
+  uint32_t left;   // index of the left child (0 if none)
+  uint32_t right;  // index of the right child (0 if none)
+
+  BTCompactNode() : left(0), right(0) {}
+  BTCompactNode( const T& elem, uint32_t left = 0, uint32_t right = 0 )
+    : elem(elem), left(left), right(right) {}
+
+  bool is_leaf() const { return left == 0 && right == 0; }
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  CompactBinaryTree
+ *
+ ****************************************************************************/
+
+/* A 'CompactBinaryTree' is a general binary tree like 'BinaryTree', with
+ * its nodes in one pool (a vector) owned by the tree.  A node is named
+ * by a 'Handle', its index in the pool; index 0 is never used, so that
+ * 0 means "no node".  Handles stay valid when the pool grows, unlike
+ * pointers or references to the elements.
+ *
+ * The nodes of 'init_complete' are in complete-tree order and those of
+ * 'init_sparse' in level order, so both builds fill the pool in one
+ * sequential pass.  Removed nodes go on a free list, threaded through
+ * their 'left' index, and are reused by 'new_node'.
+ *
+ * The operations of 'BinaryTree' are provided on handles; all of them
+ * are iterative, so they work for trees of any depth.  A tree converts
+ * to and from a 'BinaryTree' through the sparse level-order encoding.
+ */
+
+template <class T>
+class CompactBinaryTree {
+ public:
+  typedef BTCompactNode<T> Node;
+  typedef uint32_t Handle;
+
+  /* Construction */
+  CompactBinaryTree() : pool(1), root(0), free_list(0) {}
+  CompactBinaryTree( T *elements, int n_elements );
+  CompactBinaryTree( const vector<bool>& present, const vector<T>& elements );
+  template<class A>
+  explicit CompactBinaryTree( const BinaryTree<T, A>& src );
+  CompactBinaryTree( const CompactBinaryTree& src );
+  CompactBinaryTree( CompactBinaryTree&& src ) noexcept;
+
+  /* Node handles: the root (0 if the tree is empty), the parts of a
+   * node, and building blocks for trees of any shape.  'new_node' may
+   * grow the pool, which moves the nodes: take no references to
+   * elements across it.  'delete_subtree' frees a subtree that is no
+   * longer linked from the tree. */
+  Handle root_node() const                 { return root; }
+  const T& elem( Handle node ) const       { return pool[node].elem; }
+  T& elem( Handle node )                   { return pool[node].elem; }
+  Handle left( Handle node ) const         { return pool[node].left; }
+  Handle right( Handle node ) const        { return pool[node].right; }
+  bool is_leaf( Handle node ) const        { return pool[node].is_leaf(); }
+
+  Handle new_node( const T& elem, Handle left = 0, Handle right = 0 );
+  void set_root( Handle node )             { root = node; }
+  void set_left( Handle node, Handle child )  { pool[node].left = child; }
+  void set_right( Handle node, Handle child ) { pool[node].right = child; }
+  void delete_subtree( Handle node );
+
+  /* Access and Tests */
+  bool is_empty() const      { return root == 0; }
+  int height() const;
+  int node_count() const;
+  int leaf_count() const;
+  size_t hash() const;
+
+  /* Memory held by the pool, in bytes */
+  size_t bytes_reserved() const { return pool.capacity() * sizeof(Node); }
+
+  /* Mutators, and other Initialization (see 'BinaryTree') */
+  bool empty_this();
+  void init_complete( T *elements, int n_elements );
+  int to_flat_array( T *elements, int max ) const;
+  void init_sparse( const vector<bool>& present, const vector<T>& elements );
+  int to_sparse_array( vector<bool>& present, vector<T>& elements ) const;
+
+  /* Replaces the contents of 'dest' by a copy of this tree */
+  template<class A>
+  void to_binary_tree( BinaryTree<T, A>& dest ) const;
+
+  /* Traversal, as in 'BinaryTree' */
+  typedef BTIndexWalk::Stack TraversalStack;
+
+  void preorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_preorder<const T>(f, stack); }
+  void inorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_inorder<const T>(f, stack); }
+  void postorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_postorder<const T>(f, stack); }
+
+  template<class F> void preorder( F&& f ) const
+    { TraversalStack stack; walk_preorder<const T>(f, stack); }
+  template<class F> void inorder( F&& f ) const
+    { TraversalStack stack; walk_inorder<const T>(f, stack); }
+  template<class F> void postorder( F&& f ) const
+    { TraversalStack stack; walk_postorder<const T>(f, stack); }
+  template<class F> void preorder( F&& f, TraversalStack& stack ) const
+    { walk_preorder<const T>(f, stack); }
+  template<class F> void inorder( F&& f, TraversalStack& stack ) const
+    { walk_inorder<const T>(f, stack); }
+  template<class F> void postorder( F&& f, TraversalStack& stack ) const
+    { walk_postorder<const T>(f, stack); }
+
+  template<class F> void preorder_mutable( F&& f )
+    { TraversalStack stack; walk_preorder<T>(f, stack); }
+  template<class F> void inorder_mutable( F&& f )
+    { TraversalStack stack; walk_inorder<T>(f, stack); }
+  template<class F> void postorder_mutable( F&& f )
+    { TraversalStack stack; walk_postorder<T>(f, stack); }
+
+  /* Iterators: 'begin()'/'end()' walk the tree inorder */
+  class iterator;
+  typedef iterator const_iterator;
+  iterator begin() const { return iterator(pool.data(), root); }
+  iterator end() const   { return iterator(); }
+
+  /* Operators */
+  bool operator==( const CompactBinaryTree& src ) const;
+  bool operator!=( const CompactBinaryTree& src ) const
+    { return !(*this == src); }
+  CompactBinaryTree& operator=( const CompactBinaryTree& src );
+  CompactBinaryTree& operator=( CompactBinaryTree&& src ) noexcept;
+
+  /* Input/Output */
+  template<class S>
+  friend ostream& operator<<( ostream& out, const CompactBinaryTree<S>& src );
+
+
+ protected:
+  vector<Node> pool;  // all the nodes; 'pool[0]' is not a node (a tree
+                      // that was moved from has no cells at all)
+  Handle root;        // root node (0 if the tree is empty)
+  Handle free_list;   // first free cell of the pool (0 if none)
+
+  /* Iterative traversal engine; each element is passed to 'f' as an
+   * 'Elem&', where 'Elem' is either 'const T' or 'T' */
+  template<class Elem, class F>
+  void walk_preorder( F& f, TraversalStack& stack ) const;
+  template<class Elem, class F>
+  void walk_inorder( F& f, TraversalStack& stack ) const;
+  template<class Elem, class F>
+  void walk_postorder( F& f, TraversalStack& stack ) const;
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  CompactBinaryTree::iterator
+ *
+ ****************************************************************************/
+
+/* An inorder iterator over the (constant) elements, like 'BTIterator';
+ * it is invalidated by any change to the tree */
+
+template <class T>
+class CompactBinaryTree<T>::iterator {
+ public:
+  typedef forward_iterator_tag iterator_category;
+  typedef T                    value_type;
+  typedef ptrdiff_t            difference_type;
+  typedef const T*             pointer;
+  typedef const T&             reference;
+
+  iterator() : pool(NULL), cur(0) {}
+  iterator( const Node *pool, Handle root ) : pool(pool), cur(0)
+    { push_left_path(root); ++(*this); }
+
+  /* Access */
+  reference operator*() const  { return pool[cur].elem; }
+  pointer operator->() const   { return &pool[cur].elem; }
+  Handle node() const          { return cur; }
+
+  /* Advancing */
+  iterator& operator++();
+  iterator operator++( int ) { iterator old(*this); ++(*this); return old; }
+
+  /* Comparison */
+  bool operator==( const iterator& src ) const { return cur == src.cur; }
+  bool operator!=( const iterator& src ) const { return cur != src.cur; }
+
+ private:
+  const Node *pool;
+  Handle cur;                  // current node (0 at the end)
+  BTSmallStack<Handle> stack;  // nodes whose left subtree is being walked
+
+  void push_left_path( Handle node );
+};
+
+
+#include "CompactBinaryTree.cpp"
+
+#endif
@@ -0,0 +1,124 @@
+//#include "CompleteBinaryTree.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/****************************************************************************/
+/***                 Implementation of CompleteBinaryTree                 ***/
+/****************************************************************************/
+
+
+/****************/
+/* Construction */
+/****************/
+
+template<class T>
+CompleteBinaryTree<T>::CompleteBinaryTree(T *elements, int n_elements)
+// Constructs this tree to have elements 'elements[1]', 'elements[2]' ...
+// ('elements[0]' is ignored, as for 'BinaryTree')
+{
+	init_complete(elements, n_elements);
+}
+
+template<class T>
+void CompleteBinaryTree<T>::init_complete(T *elements, int n_elements)
+// The array already is the representation: it is copied as a whole,
+// except for 'elements[0]', which may be uninitialized
+{
+	if (n_elements < 0)
+		n_elements = 0;
+	elems.assign(1, T());
+	elems.insert(elems.end(), elements + 1, elements + 1 + n_elements);
+}
+
+/********************/
+/* Access and Tests */
+/********************/
+
+template<class T>
+int CompleteBinaryTree<T>::height() const
+// The height of a complete tree having 'n' nodes is the number of
+// bits in 'n', i.e., the depth of the last node plus one
+{
+	int h = 0;
+	for (unsigned n = node_count(); n > 0; n >>= 1)
+		h++;
+	return h;
+}
+
+/*************/
+/* Traversal */
+/*************/
+
+template<class T>
+void CompleteBinaryTree<T>::preorder(void(*f)(const T&), size_t index) const
+{
+	if (index >= elems.size())
+		return;
+	f(elems[index]);
+	preorder(f, 2 * index);
+	preorder(f, 2 * index + 1);
+}
+
+template<class T>
+void CompleteBinaryTree<T>::inorder(void(*f)(const T&), size_t index) const
+{
+	if (index >= elems.size())
+		return;
+	inorder(f, 2 * index);
+	f(elems[index]);
+	inorder(f, 2 * index + 1);
+}
+
+template<class T>
+void CompleteBinaryTree<T>::postorder(void(*f)(const T&), size_t index) const
+{
+	if (index >= elems.size())
+		return;
+	postorder(f, 2 * index);
+	postorder(f, 2 * index + 1);
+	f(elems[index]);
+}
+
+/************************/
+/* Conversion to Arrays */
+/************************/
+
+template<class T>
+int CompleteBinaryTree<T>::to_flat_array(T *elements, int max) const
+// Same contract as 'BinaryTree::to_flat_array': at most 'max' elements
+// are copied starting at 'elements[1]'; the return value is the total
+// number of nodes.  The storage already is in complete-tree order, so
+// this is a single block copy
+{
+	int n = min(max, node_count());
+	if (n > 0)
+		copy(elems.begin() + 1, elems.begin() + 1 + n, elements + 1);
+	return node_count();
+}
+
+/**************************/
+/* Input/Output Operators */
+/**************************/
+
+template<class T>
+void CompleteBinaryTree<T>::write_inorder(ostream& out, const vector<T>& elems,
+	size_t index)
+// Helper for the 'operator<<' below
+{
+	if (index >= elems.size())
+		return;
+	write_inorder(out, elems, 2 * index);
+	out << elems[index] << " ";
+	write_inorder(out, elems, 2 * index + 1);
+}
+
+template<class T>
+ostream& operator<<(ostream& out, const CompleteBinaryTree<T>& src)
+// Writes the elements by way of an inorder traversal, like the
+// 'BinaryTree' output operator
+{
+	CompleteBinaryTree<T>::write_inorder(out, src.elems, 1);
+	return out;
+}
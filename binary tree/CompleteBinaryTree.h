@@ -0,0 +1,81 @@
+#ifndef __CompleteBinaryTree_H
+#define __CompleteBinaryTree_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  CompleteBinaryTree
+ *
+ ****************************************************************************/
+
+/* A 'CompleteBinaryTree' holds a complete binary tree without any node
+ * pointers: the elements are kept in one contiguous array in the
+ * complete-tree order described in "BinaryTree.cpp" (root at index 1,
+ * children of node 'i' at '2*i' and '2*i + 1').  It offers the same
+ * interface as 'BinaryTree' for a complete tree, but the shape is
+ * implied by the element count, so 'height', 'node_count' and
+ * 'leaf_count' take constant time and 'to_flat_array' is a plain copy.
+ */
+
+template <class T>
+class CompleteBinaryTree {
+ public:
+
+  /* Construction */
+  CompleteBinaryTree() : elems(1) {}
+  CompleteBinaryTree( T *elements, int n_elements );
+
+  /* Access and Tests */
+  bool is_empty() const      { return node_count() == 0; }
+  int height() const;
+  int node_count() const     { return int(elems.size()) - 1; }
+  int leaf_count() const     { return (node_count() + 1)/2; }
+
+  /* The element at complete-tree index 'index' (1 <= index <= node_count) */
+  const T& operator[]( int index ) const { return elems[index]; }
+  T& operator[]( int index )             { return elems[index]; }
+
+  /* Mutators, and other Initialization */
+  bool empty_this() { elems.resize(1); return true; }
+  void init_complete( T *elements, int n_elements );
+  int to_flat_array( T* elements, int max ) const;
+
+  /* Traversal */
+  void preorder( void (*f)(const T&) )  const { preorder(f, 1); }
+  void inorder( void (*f)(const T&) )   const { inorder(f, 1); }
+  void postorder( void (*f)(const T&) ) const { postorder(f, 1); }
+
+  /* Operators */
+  bool operator==( const CompleteBinaryTree& src ) const
+    { return node_count() == src.node_count()
+             && equal(elems.begin() + 1, elems.end(), src.elems.begin() + 1); }
+  bool operator!=( const CompleteBinaryTree& src ) const
+    { return !((*this) == src); }
+
+  /* Input/Output */
+  template<class S>
+  friend ostream& operator<<( ostream& out, const CompleteBinaryTree<S>& src );
+
+
+ protected:
+  vector<T> elems;  // elements in complete-tree order; 'elems[0]' is unused
+
+  /* "Helper" functions for the traversals and the output, starting at
+   * 'index'.  The indices are 'size_t', so that '2*index + 1' does not
+   * overflow for a tree of more than 2^30 nodes */
+  void preorder( void (*f)(const T&), size_t index ) const;
+  void inorder( void (*f)(const T&), size_t index ) const;
+  void postorder( void (*f)(const T&), size_t index ) const;
+  static void write_inorder( ostream& out, const vector<T>& elems,
+                             size_t index );
+};
+
+
+#include "CompleteBinaryTree.cpp"
+
+#endif
@@ -0,0 +1,123 @@
+//#include "EytzingerTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                  Implementation of EytzingerTree                     ***/
+/****************************************************************************/
+
+template<class T, class Compare>
+EytzingerTree<T, Compare>::EytzingerTree(const T *sorted, int n_elements,
+	const Compare& less_than)
+	: less_than(less_than)
+{
+	init_sorted(sorted, n_elements);
+}
+
+template<class T, class Compare>
+void EytzingerTree<T, Compare>::init_sorted(const T *sorted, int n_elements)
+{
+	if (n_elements < 0)
+		n_elements = 0;
+	this->elems.resize(n_elements + 1);
+	int next = 0;
+	init_sorted(sorted, next, 1);
+}
+
+template<class T, class Compare>
+void EytzingerTree<T, Compare>::init_sorted(const T *sorted, int& next,
+	int index)
+// Fills the subtree at 'index' inorder, from 'sorted[next]' on
+{
+	if (index > this->node_count())
+		return;
+	init_sorted(sorted, next, 2 * index);
+	this->elems[index] = sorted[next++];
+	init_sorted(sorted, next, 2 * index + 1);
+}
+
+/*************/
+/* Searching */
+/*************/
+
+template<class T, class Compare>
+int EytzingerTree<T, Compare>::lower_bound_index(const T& elem) const
+{
+	const T *base = this->elems.data();
+	unsigned n = this->node_count(), k = 1;
+	while (k <= n) {
+		prefetch(base + size_t(16) * k);
+		k = 2 * k + less_than(base[k], elem);
+	}
+	return lower_bound_from(k);
+}
+
+template<class T, class Compare>
+const T* EytzingerTree<T, Compare>::lower_bound(const T& elem) const
+{
+	int k = lower_bound_index(elem);
+	return (k ? &this->elems[k] : NULL);
+}
+
+template<class T, class Compare>
+bool EytzingerTree<T, Compare>::contains(const T& elem) const
+{
+	int k = lower_bound_index(elem);
+	return k && !less_than(elem, this->elems[k]);
+}
+
+template<class T, class Compare>
+void EytzingerTree<T, Compare>::lower_bound_batch(const T *queries,
+	int n_queries, int *results) const
+// The queries go in groups.  Every search goes through all the full
+// levels of the tree (the height less one), so a group takes them in
+// lock step without any test, and then the last, partial level
+{
+	const int group = 16;
+	const T *base = this->elems.data();
+	unsigned n = this->node_count();
+	int full_levels = this->height() - 1;
+	unsigned k[group];
+
+	for (int first = 0; first < n_queries; first += group) {
+		int m = min(group, n_queries - first);
+		const T *q = queries + first;
+		for (int j = 0; j < m; j++)
+			k[j] = 1;
+		for (int level = 0; level < full_levels; level++) {
+			for (int j = 0; j < m; j++) {
+				prefetch(base + size_t(16) * k[j]);
+				k[j] = 2 * k[j] + less_than(base[k[j]], q[j]);
+			}
+		}
+		for (int j = 0; j < m; j++) {
+			if (k[j] <= n)
+				k[j] = 2 * k[j] + less_than(base[k[j]], q[j]);
+			results[first + j] = (n ? lower_bound_from(k[j]) : 0);
+		}
+	}
+}
+
+template<class T, class Compare>
+int EytzingerTree<T, Compare>::first_zero(unsigned k)
+// The number of trailing 1 bits of 'k', plus one
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward(&bit, ~k);
+	return int(bit) + 1;
+#else
+	return __builtin_ffs(int(~k));
+#endif
+}
+
+template<class T, class Compare>
+void EytzingerTree<T, Compare>::prefetch(const T *p)
+// Only a hint: it never faults, even past the end of the array
+{
+#ifdef _MSC_VER
+	_mm_prefetch((const char*) p, _MM_HINT_T0);
+#else
+	__builtin_prefetch(p);
+#endif
+}
@@ -0,0 +1,101 @@
+#ifndef __EytzingerTree_H
+#define __EytzingerTree_H
+
+#include <functional>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "CompleteBinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  EytzingerTree
+ *
+ ****************************************************************************/
+
+/* An 'EytzingerTree' is a complete binary search tree in the array
+ * layout of 'CompleteBinaryTree' (root at index 1, children of 'k' at
+ * '2*k' and '2*k + 1'), known as the Eytzinger layout.  It is built from
+ * a sorted range and is read-only.
+ *
+ * The search needs no pointers and no branches: at every level 'k'
+ * becomes '2*k' or '2*k + 1' depending on one comparison, which the
+ * compiler turns into arithmetic.  The 16 descendants of 'k' four levels
+ * down lie next to each other at '16*k' ... '16*k + 15', so the search
+ * prefetches them while it works through the next levels.  The batch
+ * search interleaves many queries, level by level, so that the memory
+ * accesses of different queries overlap.
+ */
+
+template <class T, class Compare = less<T> >
+class EytzingerTree : private CompleteBinaryTree<T> {
+ public:
+
+  /* Construction */
+  EytzingerTree( const Compare& less_than = Compare() )
+    : less_than(less_than) {}
+  EytzingerTree( const T *sorted, int n_elements,
+                 const Compare& less_than = Compare() );
+
+  /* Replaces the contents by 'sorted[0]' ... 'sorted[n_elements - 1]',
+   * which must be in increasing order */
+  void init_sorted( const T *sorted, int n_elements );
+
+  /* The complete-tree index of the least element that is not less than
+   * 'elem', or 0 if there is none; 'lower_bound' returns the element */
+  int lower_bound_index( const T& elem ) const;
+  const T *lower_bound( const T& elem ) const;
+  bool contains( const T& elem ) const;
+
+  /* Stores 'lower_bound_index(queries[i])' in 'results[i]' for the
+   * 'n_queries' queries */
+  void lower_bound_batch( const T *queries, int n_queries,
+                          int *results ) const;
+
+  /* The queries of 'CompleteBinaryTree'.  The base is private, so that
+   * nothing but 'init_sorted' can change the elements and break their
+   * order */
+  using CompleteBinaryTree<T>::is_empty;
+  using CompleteBinaryTree<T>::height;
+  using CompleteBinaryTree<T>::node_count;
+  using CompleteBinaryTree<T>::leaf_count;
+  using CompleteBinaryTree<T>::to_flat_array;
+
+  const T& operator[]( int index ) const { return this->elems[index]; }
+
+  void preorder( void (*f)(const T&) ) const
+    { CompleteBinaryTree<T>::preorder(f); }
+  void inorder( void (*f)(const T&) ) const
+    { CompleteBinaryTree<T>::inorder(f); }
+  void postorder( void (*f)(const T&) ) const
+    { CompleteBinaryTree<T>::postorder(f); }
+
+  bool operator==( const EytzingerTree& src ) const
+    { return CompleteBinaryTree<T>::operator==(src); }
+  bool operator!=( const EytzingerTree& src ) const
+    { return !((*this) == src); }
+
+
+ protected:
+  Compare less_than;
+
+  void init_sorted( const T *sorted, int& next, int index );
+
+  /* The index reached by a search that went down from the root, with
+   * the last comparison made at a leaf: removing the final right turns
+   * and the left turn before them gives the index of the lower bound */
+  static int lower_bound_from( unsigned k ) { return int(k >> first_zero(k)); }
+  static int first_zero( unsigned k );
+
+  static void prefetch( const T *p );
+};
+
+
+#include "EytzingerTree.cpp"
+
+#endif
@@ -0,0 +1,505 @@
+//#include "PersistentBinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***               Implementation of PersistentBinaryTree                 ***/
+/****************************************************************************/
+
+template<class T>
+PersistentBinaryTree<T>::PersistentBinaryTree(T *elements, int n_elements)
+// Constructs a complete tree from 'elements[1]' ... 'elements[n_elements]'
+// (see 'BinaryTree::init_complete')
+{
+	root = NULL;
+	interner = NULL;
+	init_complete(elements, n_elements);
+}
+
+template<class T>
+PersistentBinaryTree<T>::PersistentBinaryTree(T *elements, int n_elements,
+	BTInterner<T>& interner)
+// Same, with the nodes interned by 'interner'
+{
+	root = NULL;
+	this->interner = NULL;
+	init_complete(elements, n_elements, interner);
+}
+
+template<class T>
+void PersistentBinaryTree<T>::init_complete(T *elements, int n_elements)
+{
+	release(root, interner);
+	root = init_complete(elements, n_elements, 1);
+	interner = NULL;
+}
+
+template<class T>
+void PersistentBinaryTree<T>::init_complete(T *elements, int n_elements,
+	BTInterner<T>& interner)
+{
+	release(root, this->interner);
+	root = init_complete(elements, n_elements, 1, interner);
+	this->interner = &interner;
+}
+
+template<class T>
+typename PersistentBinaryTree<T>::Node*
+PersistentBinaryTree<T>::init_complete(T *elements, int n_elements, int index)
+{
+	if (index > n_elements)
+		return NULL;
+	return new Node(elements[index],
+		init_complete(elements, n_elements, 2 * index),
+		init_complete(elements, n_elements, 2 * index + 1));
+}
+
+template<class T>
+typename PersistentBinaryTree<T>::Node*
+PersistentBinaryTree<T>::init_complete(T *elements, int n_elements, int index,
+	BTInterner<T>& interner)
+// Builds bottom-up, so that the children are interned before the node
+{
+	if (index > n_elements)
+		return NULL;
+	Node *left = init_complete(elements, n_elements, 2 * index, interner);
+	Node *right = init_complete(elements, n_elements, 2 * index + 1, interner);
+	Node *node = interner.intern(elements[index], left, right);
+	interner.release(left);
+	interner.release(right);
+	return node;
+}
+
+/**********************/
+/* Reference counting */
+/**********************/
+
+template<class T>
+typename PersistentBinaryTree<T>::Node*
+PersistentBinaryTree<T>::acquire(Node *node)
+// Adds a link to 'node' (which may be NULL) and returns it
+{
+	if (node)
+		node->ref_count.fetch_add(1, memory_order_relaxed);
+	return node;
+}
+
+template<class T>
+void PersistentBinaryTree<T>::release(Node *node)
+// Drops a link to 'node'.  A node losing its last link is deleted, and
+// its links to its children are dropped in turn.  This goes without
+// recursion, so that releasing a degenerate tree cannot overflow the
+// stack
+{
+	vector<Node*> pending;
+	while (node) {
+		if (node->ref_count.fetch_sub(1, memory_order_acq_rel) == 1) {
+			if (node->right)
+				pending.push_back(node->right);
+			Node *left = node->left;
+			delete node;
+			node = left;
+		} else
+			node = NULL;
+		if (!node && !pending.empty()) {
+			node = pending.back();
+			pending.pop_back();
+		}
+	}
+}
+
+template<class T>
+void PersistentBinaryTree<T>::release(Node *node, BTInterner<T> *interner)
+// Drops a link to a node of a tree built through 'interner' (or of a
+// plain tree if it is NULL)
+{
+	if (interner)
+		interner->release(node);
+	else
+		release(node);
+}
+
+template<class T>
+typename PersistentBinaryTree<T>::Node*
+PersistentBinaryTree<T>::unshare(Node *node)
+// PRE: 'node' is reached through links owned by this tree only
+// Returns a node with the contents of 'node' that no other tree can
+// see: 'node' itself if this tree holds its only link, or else a copy
+// that shares the children of 'node', which loses a link
+{
+	if (node->ref_count.load(memory_order_acquire) == 1)
+		return node;
+	Node *copy = new Node(node->elem, acquire(node->left),
+		acquire(node->right));
+	release(node);
+	return copy;
+}
+
+/**************************/
+/* Access to single nodes */
+/**************************/
+
+template<class T>
+typename PersistentBinaryTree<T>::Node*
+PersistentBinaryTree<T>::find(int index) const
+// Returns the node at complete-tree index 'index', or NULL if there is
+// none.  The bits of 'index' after the leading 1, from the most
+// significant one, tell the way down: 0 for left and 1 for right
+{
+	if (index < 1)
+		return NULL;
+	int bit = 0;
+	while ((index >> bit) > 1)
+		bit++;
+
+	Node *node = root;
+	while (node && bit-- > 0)
+		node = ((index >> bit) & 1) ? node->right : node->left;
+	return node;
+}
+
+template<class T>
+const T& PersistentBinaryTree<T>::at(int index) const
+// PRE: contains(index)
+// The element at complete-tree index 'index'
+{
+	return find(index)->elem;
+}
+
+template<class T>
+typename PersistentBinaryTree<T>::Node**
+PersistentBinaryTree<T>::path_to(int index)
+// PRE: index == 1 or the node at 'index / 2' exists
+// Unshares every node above complete-tree index 'index' and returns the
+// link that leads to 'index' (which may hold NULL); that link may then
+// be changed without affecting any other tree
+{
+	int bit = 0;
+	while ((index >> bit) > 1)
+		bit++;
+
+	Node **link = &root;
+	while (bit-- > 0) {
+		Node *node = *link = unshare(*link);
+		link = ((index >> bit) & 1) ? &node->right : &node->left;
+	}
+	return link;
+}
+
+template<class T>
+void PersistentBinaryTree<T>::replace_interned(int index, Node *subtree)
+// PRE: index == 1 or the node at 'index / 2' exists
+// Puts 'subtree' (whose link is handed over) at complete-tree index
+// 'index' of an interned tree.  Interned nodes may be shared without
+// this tree knowing, so none is modified: the path above 'index' is
+// interned again from the bottom up
+{
+	int bit = 0;
+	while ((index >> bit) > 1)
+		bit++;
+
+	vector<Node*> path;
+	Node *node = root;
+	for (int b = bit - 1; b >= 0; b--) {
+		path.push_back(node);
+		node = ((index >> b) & 1) ? node->right : node->left;
+	}
+
+	Node *cur = subtree;
+	for (int k = int(path.size()) - 1; k >= 0; k--) {
+		bool right = (index >> (bit - 1 - k)) & 1;
+		Node *up = interner->intern(path[k]->elem,
+			right ? path[k]->left : cur, right ? cur : path[k]->right);
+		interner->release(cur);
+		cur = up;
+	}
+	interner->release(root);
+	root = cur;
+}
+
+/**************************************/
+/* Mutators, and other Initialization */
+/**************************************/
+
+template<class T>
+bool PersistentBinaryTree<T>::set(int index, const T& elem)
+// Stores 'elem' at complete-tree index 'index', adding a leaf if there
+// is no node there yet.  The nodes on the path are copied if other
+// trees share them.  Returns false (and changes nothing) if the parent
+// of 'index' does not exist
+{
+	if (index < 1 || (index > 1 && !find(index / 2)))
+		return false;
+
+	if (interner) {
+		Node *old = find(index);
+		replace_interned(index, interner->intern(elem,
+			old ? old->left : NULL, old ? old->right : NULL));
+		return true;
+	}
+
+	Node **link = path_to(index);
+	if (*link) {
+		*link = unshare(*link);
+		(*link)->elem = elem;
+	} else
+		*link = new Node(elem);
+	return true;
+}
+
+template<class T>
+bool PersistentBinaryTree<T>::erase(int index)
+// Removes the subtree at complete-tree index 'index' from this tree;
+// other trees sharing it keep it.  Returns false if there is no node
+// at 'index'
+{
+	if (!find(index))
+		return false;
+
+	if (interner) {
+		replace_interned(index, NULL);
+		return true;
+	}
+
+	Node **link = path_to(index);
+	release(*link);
+	*link = NULL;
+	return true;
+}
+
+/*************/
+/* Operators */
+/*************/
+
+template<class T>
+PersistentBinaryTree<T>&
+PersistentBinaryTree<T>::operator=(const PersistentBinaryTree& src)
+// Shares the nodes of 'src' in constant time; the old nodes of this
+// tree lose a link.  The new root is acquired first, in case it is
+// reached from the old one
+{
+	Node *old_root = root;
+	root = acquire(src.root);
+	release(old_root, interner);
+	interner = src.interner;
+	return *this;
+}
+
+template<class T>
+PersistentBinaryTree<T>&
+PersistentBinaryTree<T>::operator=(PersistentBinaryTree&& src) noexcept
+{
+	if (this != &src) {
+		release(root, interner);
+		root = src.root;
+		interner = src.interner;
+		src.root = NULL;
+	}
+	return *this;
+}
+
+template<class T>
+bool PersistentBinaryTree<T>::operator==(const PersistentBinaryTree& src) const
+// Trees interned by the same interner are equal only if they have the
+// same root
+{
+	if (interner && interner == src.interner)
+		return root == src.root;
+	return compare(root, src.root);
+}
+
+template<class T>
+bool PersistentBinaryTree<T>::compare(const Node *a, const Node *b)
+// Shared subtrees are equal without looking into them.  The pairs of
+// subtrees still to be compared wait on an explicit stack, as in the
+// walks of 'BinaryTree', so that no depth overflows the call stack
+{
+	vector<pair<const Node*, const Node*> > stack(1, make_pair(a, b));
+	while (!stack.empty()) {
+		a = stack.back().first;
+		b = stack.back().second;
+		stack.pop_back();
+		if (a == b)
+			continue;
+		if (!a || !b || !(a->elem == b->elem))
+			return 0;
+		stack.push_back(make_pair(a->right, b->right));
+		stack.push_back(make_pair(a->left, b->left));
+	}
+	return 1;
+}
+
+/**************/
+/* Statistics */
+/**************/
+
+/*
+ * The statistics keep the pending subtrees on an explicit stack, like
+ * 'release', so that they work for trees of any depth.
+ */
+
+template<class T>
+int PersistentBinaryTree<T>::height(const Node *node)
+// The stack holds the pending nodes with their depth
+{
+	int h = 0;
+	vector<pair<const Node*, int> > stack;
+	if (node)
+		stack.push_back(make_pair(node, 1));
+	while (!stack.empty()) {
+		node = stack.back().first;
+		int depth = stack.back().second;
+		stack.pop_back();
+		h = max(h, depth);
+		if (node->left)
+			stack.push_back(make_pair((const Node*) node->left, depth + 1));
+		if (node->right)
+			stack.push_back(make_pair((const Node*) node->right, depth + 1));
+	}
+	return h;
+}
+
+template<class T>
+int PersistentBinaryTree<T>::node_count(const Node *node)
+{
+	int n = 0;
+	for (preorder_iterator it((Node*) node); it != preorder_iterator(); ++it)
+		n++;
+	return n;
+}
+
+template<class T>
+int PersistentBinaryTree<T>::leaf_count(const Node *node)
+{
+	int n = 0;
+	for (preorder_iterator it((Node*) node); it != preorder_iterator(); ++it) {
+		if (it.node()->is_leaf())
+			n++;
+	}
+	return n;
+}
+
+/************************/
+/* Conversion to Arrays */
+/************************/
+
+template<class T>
+int PersistentBinaryTree<T>::to_flat_array(T *elements, int max) const
+// Same as 'BinaryTree::to_flat_array'; the complete-tree indices are
+// carried along on the stack of pending nodes
+{
+	int max_index = 0;
+	vector<pair<const Node*, int> > stack;
+	if (root)
+		stack.push_back(make_pair((const Node*) root, 1));
+	while (!stack.empty()) {
+		const Node *node = stack.back().first;
+		int index = stack.back().second;
+		stack.pop_back();
+		if (index > max_index)
+			max_index = index;
+		if (index <= max)
+			elements[index] = node->elem;
+		if (node->left)
+			stack.push_back(make_pair((const Node*) node->left, 2 * index));
+		if (node->right)
+			stack.push_back(make_pair((const Node*) node->right, 2 * index + 1));
+	}
+	return max_index;
+}
+
+/****************/
+/* Input/Output */
+/****************/
+
+template<class T>
+ostream& operator<<(ostream& out, const PersistentBinaryTree<T>& src)
+// Writes the elements by way of an inorder traversal
+{
+	src.inorder([&out](const T& elem) { out << elem << " "; });
+	return out;
+}
+
+/****************************************************************************/
+/***                    Implementation of BTInterner                      ***/
+/****************************************************************************/
+
+template<class T>
+BTInterner<T>::~BTInterner()
+// Drops the links of the table (to nodes still in use, if any).  A node
+// is never freed before its own link is dropped, so the ones not
+// visited yet stay valid
+{
+	for (int k = 0; k < n_shards; k++) {
+		for (Node *node : shards[k].nodes)
+			PersistentBinaryTree<T>::release(node);
+	}
+}
+
+template<class T>
+typename BTInterner<T>::Node*
+BTInterner<T>::intern(const T& elem, Node *left, Node *right)
+{
+	Node probe(elem, left, right);
+	Shard& shard = shard_of(NodeHash()(&probe));
+	requests.fetch_add(1, memory_order_relaxed);
+
+	lock_guard<mutex> guard(shard.lock);
+	typename unordered_set<Node*, NodeHash, NodeEqual>::iterator it =
+		shard.nodes.find(&probe);
+	if (it != shard.nodes.end()) {
+		hits.fetch_add(1, memory_order_relaxed);
+		return PersistentBinaryTree<T>::acquire(*it);
+	}
+	Node *node = new Node(elem, PersistentBinaryTree<T>::acquire(left),
+		PersistentBinaryTree<T>::acquire(right));
+	shard.nodes.insert(node);
+	return PersistentBinaryTree<T>::acquire(node);
+}
+
+template<class T>
+void BTInterner<T>::release(Node *node)
+// Same as 'PersistentBinaryTree::release', except that a node whose
+// only other link is the one of the table is taken out of the table
+// and freed.  The count is dropped under the lock of the shard, which
+// 'intern' holds to hand out a link: a node left to the table alone
+// cannot be handed out again while it goes
+{
+	vector<Node*> pending;
+	while (node) {
+		bool unused;
+		{
+			Shard& shard = shard_of(NodeHash()(node));
+			lock_guard<mutex> guard(shard.lock);
+			unused = (node->ref_count.fetch_sub(1, memory_order_acq_rel) == 2);
+			if (unused)
+				shard.nodes.erase(node);
+		}
+		if (unused) {
+			if (node->right)
+				pending.push_back(node->right);
+			Node *left = node->left;
+			delete node;
+			node = left;
+		} else
+			node = NULL;
+		if (!node && !pending.empty()) {
+			node = pending.back();
+			pending.pop_back();
+		}
+	}
+}
+
+template<class T>
+BTInternStats BTInterner<T>::stats() const
+{
+	BTInternStats stats;
+	stats.requests = requests.load();
+	stats.hits = hits.load();
+	stats.distinct = 0;
+	for (int k = 0; k < n_shards; k++) {
+		lock_guard<mutex> guard(shards[k].lock);
+		stats.distinct += shards[k].nodes.size();
+	}
+	return stats;
+}
@@ -0,0 +1,223 @@
+#ifndef __PersistentBinaryTree_H
+#define __PersistentBinaryTree_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
+#include "BinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  PersistentBinaryTree
+ *
+ ****************************************************************************/
+
+/* A 'PersistentBinaryTree' is a binary tree whose copies share their
+ * nodes instead of duplicating them.  Every node carries a reference
+ * count ('BTRefCount'), so copying a tree only takes a reference to its
+ * root, in constant time.  A change never modifies a node that another
+ * tree can see: the nodes on the path from the root to the change are
+ * copied first ("path copying"), unless this tree is their only owner,
+ * and the rest stays shared.  An update thus costs O(height) new nodes
+ * at most, and many versions of a large tree fit in little more memory
+ * than one.
+ *
+ * Nodes are addressed by their index in the complete-tree numbering (see
+ * "BinaryTree.cpp"): the root is 1 and the children of node 'i' are
+ * '2*i' and '2*i + 1', whatever the actual shape of the tree.
+ *
+ * The nodes come from the global heap, since they can outlive the tree
+ * that created them.  Different trees sharing nodes may be used from
+ * different threads; a single tree is not thread-safe.
+ *
+ * A tree may also be built through a 'BTInterner' (see below), which
+ * makes equal subtrees share a single node.  Such a tree stays interned
+ * when it is changed, and compares with another tree of the same
+ * interner by comparing the roots only.
+ */
+
+template <class T> class BTInterner;
+
+template <class T>
+class PersistentBinaryTree {
+ public:
+  typedef BTNode<T, BTRefCount> Node;
+
+  /* Construction */
+  PersistentBinaryTree() { root = NULL; interner = NULL; }
+  PersistentBinaryTree( T *elements, int n_elements );
+  PersistentBinaryTree( T *elements, int n_elements,
+                        BTInterner<T>& interner );
+  PersistentBinaryTree( const PersistentBinaryTree& src )
+    { root = acquire(src.root); interner = src.interner; }
+  PersistentBinaryTree( PersistentBinaryTree&& src ) noexcept
+    { root = src.root; interner = src.interner; src.root = NULL; }
+  ~PersistentBinaryTree() { release(root, interner); }
+
+  /* Access and Tests */
+  bool is_empty() const      { return root == NULL; }
+  int height() const         { return height(root); }
+  int node_count() const     { return node_count(root); }
+  int leaf_count() const     { return leaf_count(root); }
+  bool contains( int index ) const { return find(index) != NULL; }
+  const T& at( int index ) const;
+  bool is_interned() const         { return interner != NULL; }
+
+  /* Mutators, and other Initialization */
+  bool empty_this() { release(root, interner); root = NULL; return true; }
+  void init_complete( T *elements, int n_elements );
+  void init_complete( T *elements, int n_elements, BTInterner<T>& interner );
+  bool set( int index, const T& elem );
+  bool erase( int index );
+  int to_flat_array( T* elements, int max ) const;
+
+  /* Traversal */
+  template<class F> void preorder( F&& f ) const
+    { for (preorder_iterator it(root); it != preorder_iterator(); ++it) f(*it); }
+  template<class F> void inorder( F&& f ) const
+    { for (inorder_iterator it(root); it != inorder_iterator(); ++it) f(*it); }
+  template<class F> void postorder( F&& f ) const
+    { for (postorder_iterator it(root); it != postorder_iterator(); ++it) f(*it); }
+
+  /* Iterators (see "BTIterator.h") */
+  typedef BTIterator<Node, BTInorder> iterator;
+  typedef BTIterator<Node, BTPreorder> preorder_iterator;
+  typedef BTIterator<Node, BTInorder> inorder_iterator;
+  typedef BTIterator<Node, BTPostorder> postorder_iterator;
+
+  iterator begin() const { return iterator(root); }
+  iterator end() const   { return iterator(); }
+
+  /* Operators */
+  bool operator==( const PersistentBinaryTree& src ) const;
+  bool operator!=( const PersistentBinaryTree& src ) const
+    { return !((*this) == src); }
+  PersistentBinaryTree& operator=( const PersistentBinaryTree& src );
+  PersistentBinaryTree& operator=( PersistentBinaryTree&& src ) noexcept;
+
+  /* Input/Output */
+  template<class S>
+  friend ostream& operator<<( ostream& out,
+                              const PersistentBinaryTree<S>& src );
+
+
+ protected:
+  Node *root;               // Root node (NULL if the tree is empty)
+  BTInterner<T> *interner;  // Interner of all the nodes (or NULL)
+
+  friend class BTInterner<T>;
+
+  /* Reference counting */
+  static Node *acquire( Node *node );
+  static void release( Node *node );
+  static void release( Node *node, BTInterner<T> *interner );
+  static Node *unshare( Node *node );
+
+  /* "Helper" functions for the basic operations */
+  Node *find( int index ) const;
+  Node **path_to( int index );
+  void replace_interned( int index, Node *subtree );
+  static Node *init_complete( T *elements, int n_elements, int index );
+  static Node *init_complete( T *elements, int n_elements, int index,
+                              BTInterner<T>& interner );
+  static bool compare( const Node *a, const Node *b );
+  static int height( const Node *node );
+  static int node_count( const Node *node );
+  static int leaf_count( const Node *node );
+};
+
+
+/****************************************************************************
+ *
+ * CLASS:  BTInterner
+ *
+ ****************************************************************************/
+
+/* A 'BTInterner' hash-conses the nodes of persistent trees: it keeps a
+ * table of nodes keyed by (element, left child, right child), and hands
+ * out the node already in the table when asked for an equal one.  Since
+ * the children are interned first, two subtrees are equal exactly when
+ * they are the same node, and repetitive data needs far fewer nodes.
+ *
+ * The table is split into shards, each with a lock of its own, so that
+ * several threads can intern at the same time.  The table holds a link
+ * to each of its nodes, and links to interned nodes are dropped through
+ * 'release': a node left with the link of the table only is taken out
+ * and freed, so the table never holds more than the nodes in use.  A
+ * tree built through an interner refers to it, and the interner must
+ * outlive that tree.  The element type needs '==' and a 'std::hash'
+ * specialization.
+ */
+
+/* Counts describing how well an interner deduplicates its nodes */
+struct BTInternStats {
+  long long requests;  // nodes asked for
+  long long hits;      // requests answered with a node already there
+  long long distinct;  // nodes in the table
+
+  /* Nodes asked for per node actually stored */
+  double dedup_ratio() const
+    { return (distinct ? double(requests) / distinct : 1.0); }
+};
+
+template <class T>
+class BTInterner {
+ public:
+  typedef typename PersistentBinaryTree<T>::Node Node;
+
+  /* Construction */
+  BTInterner() : requests(0), hits(0) {}
+  ~BTInterner();
+
+  /* Returns the node with element 'elem' and children 'left' and
+   * 'right', which must be interned nodes (or NULL).  The caller gets a
+   * new link to the node */
+  Node *intern( const T& elem, Node *left, Node *right );
+
+  /* Drops a link to the interned node 'node' (which may be NULL) */
+  void release( Node *node );
+
+  /* Access */
+  BTInternStats stats() const;
+
+
+ protected:
+  /* Nodes hash and compare by their element and the addresses of their
+   * children */
+  struct NodeHash {
+    size_t operator()( const Node *node ) const {
+      return BTSubtreeHash::node_hash(node->elem,
+        hash<const Node*>()(node->left), hash<const Node*>()(node->right));
+    }
+  };
+  struct NodeEqual {
+    bool operator()( const Node *a, const Node *b ) const {
+      return a->left == b->left && a->right == b->right
+             && a->elem == b->elem;
+    }
+  };
+
+  static const int n_shards = 64;
+  struct Shard {
+    mutable mutex lock;
+    unordered_set<Node*, NodeHash, NodeEqual> nodes;
+  };
+  Shard shards[n_shards];
+
+  Shard& shard_of( size_t node_hash )
+    { return shards[(node_hash >> 16) % n_shards]; }
+
+  atomic<long long> requests;
+  atomic<long long> hits;
+
+  BTInterner( const BTInterner& );             // not copyable
+  BTInterner& operator=( const BTInterner& );
+};
+
+
+#include "PersistentBinaryTree.cpp"
+
+#endif
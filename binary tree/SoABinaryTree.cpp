@@ -0,0 +1,254 @@
+//#include "SoABinaryTree.h"
+
+using namespace std;
+
+/****************************************************************************/
+/***                   Implementation of SoABinaryTree                    ***/
+/****************************************************************************/
+
+/****************/
+/* Construction */
+/****************/
+
+template<class T>
+SoABinaryTree<T>::SoABinaryTree(T *elements, int n_elements)
+// Constructs a complete tree from 'elements[1]' ... 'elements[n_elements]'
+// (see 'BinaryTree::init_complete')
+{
+	init_complete(elements, n_elements);
+}
+
+template<class T>
+SoABinaryTree<T>::SoABinaryTree(const vector<bool>& present,
+	const vector<T>& elements)
+// Constructs a tree from its sparse encoding (see 'init_sparse')
+{
+	init_sparse(present, elements);
+}
+
+template<class T>
+template<class A>
+SoABinaryTree<T>::SoABinaryTree(const BinaryTree<T, A>& src)
+{
+	vector<bool> present;
+	vector<T> elements;
+	src.to_sparse_array(present, elements);
+	init_sparse(present, elements);
+}
+
+/********************/
+/* Access and Tests */
+/********************/
+
+template<class T>
+int SoABinaryTree<T>::height() const
+{
+	return BTIndexWalk::height(*this);
+}
+
+template<class T>
+int SoABinaryTree<T>::leaf_count() const
+// Every cell is a node, so the leaves are counted straight off the
+// index arrays
+{
+	const Handle *l = lefts.data(), *r = rights.data();
+	int n = 0;
+	for (size_t k = 1; k < lefts.size(); k++)
+		n += ((l[k] | r[k]) == 0);
+	return n;
+}
+
+template<class T>
+size_t SoABinaryTree<T>::hash() const
+// The same hash as 'BinaryTree::hash', for a tree of the same shape and
+// elements
+{
+	return BTIndexWalk::hash(*this);
+}
+
+/**************/
+/* Aggregates */
+/**************/
+
+template<class T>
+template<class R, class Op>
+R SoABinaryTree<T>::reduce(R init, Op op) const
+// The elements are combined into eight independent partial results,
+// one per lane, which leaves the compiler free to keep the lanes in
+// one vector register; the lanes are combined at the end
+{
+	const int lanes = 8;
+	R partial[lanes];
+	for (int j = 0; j < lanes; j++)
+		partial[j] = init;
+
+	const T *e = elems.data() + 1;
+	size_t n = elems.size() - 1, k = 0;
+	for (; k + lanes <= n; k += lanes) {
+		for (int j = 0; j < lanes; j++)
+			partial[j] = op(partial[j], e[k + j]);
+	}
+	for (; k < n; k++)
+		partial[0] = op(partial[0], e[k]);
+
+	R result = init;
+	for (int j = 0; j < lanes; j++)
+		result = op(result, partial[j]);
+	return result;
+}
+
+template<class T>
+template<class Pred>
+int SoABinaryTree<T>::count_if(Pred pred) const
+{
+	const T *e = elems.data() + 1;
+	size_t n = elems.size() - 1;
+	int count = 0;
+	for (size_t k = 0; k < n; k++)
+		count += (pred(e[k]) ? 1 : 0);
+	return count;
+}
+
+/**************************************/
+/* Mutators, and other Initialization */
+/**************************************/
+
+template<class T>
+bool SoABinaryTree<T>::empty_this()
+{
+	vector<T>(1).swap(elems);
+	vector<Handle>(1).swap(lefts);
+	vector<Handle>(1).swap(rights);
+	return true;
+}
+
+template<class T>
+void SoABinaryTree<T>::init_complete(T *elements, int n_elements)
+// Complete-tree index 'i' is node 'i', as in
+// 'CompactBinaryTree::init_complete'
+{
+	empty_this();
+	if (n_elements <= 0)
+		return;
+	uint32_t n = uint32_t(n_elements);
+	elems.assign(1, T());
+	elems.insert(elems.end(), elements + 1, elements + n + 1);
+	lefts.resize(n + 1);
+	rights.resize(n + 1);
+	for (uint32_t i = 1; i <= n; i++) {
+		lefts[i] = (2 * i <= n ? 2 * i : 0);
+		rights[i] = (2 * i + 1 <= n ? 2 * i + 1 : 0);
+	}
+}
+
+template<class T>
+int SoABinaryTree<T>::to_flat_array(T *elements, int max) const
+// PRE: This is a complete binary tree
+{
+	return BTIndexWalk::to_flat_array(*this, elements, max);
+}
+
+template<class T>
+void SoABinaryTree<T>::init_sparse(const vector<bool>& present,
+	const vector<T>& elements)
+// Same as 'CompactBinaryTree::init_sparse': the node of link 'k' is the
+// next one to be added, and link 'k' belongs to node '(k + 1) / 2' (the
+// root link 0 to none: the root is node 1)
+{
+	empty_this();
+	elems.reserve(elements.size() + 1);
+	lefts.reserve(elements.size() + 1);
+	rights.reserve(elements.size() + 1);
+	size_t n_links = 1;  // links known so far: the root link, and two per node
+	for (size_t k = 0; k < n_links; k++) {
+		if (k >= present.size() || !present[k]
+		    || elems.size() - 1 == elements.size())
+			continue;
+		Handle node = Handle(elems.size());
+		elems.push_back(elements[node - 1]);
+		lefts.push_back(0);
+		rights.push_back(0);
+		if (k % 2)
+			lefts[(k + 1) / 2] = node;
+		else if (k > 0)
+			rights[k / 2] = node;
+		n_links += 2;
+	}
+}
+
+template<class T>
+int SoABinaryTree<T>::to_sparse_array(vector<bool>& present,
+	vector<T>& elements) const
+{
+	return BTIndexWalk::to_sparse_array(*this, present, elements);
+}
+
+template<class T>
+template<class A>
+void SoABinaryTree<T>::to_binary_tree(BinaryTree<T, A>& dest) const
+{
+	vector<bool> present;
+	vector<T> elements;
+	to_sparse_array(present, elements);
+	dest.init_sparse(present, elements);
+}
+
+/*************/
+/* Traversal */
+/*************/
+
+/*
+ * The walks themselves are those of 'BTIndexWalk', which follows the
+ * index arrays; the handles it passes are turned into elements here.
+ * The mutable traversals only change elements, so the element array is
+ * taken as non-constant for them alone.
+ */
+
+template<class T>
+template<class Elem, class F>
+void SoABinaryTree<T>::walk_preorder(F& f, TraversalStack& stack) const
+{
+	T *e = const_cast<T*>(elems.data());
+	auto visit = [&f, e](Handle k) { f(static_cast<Elem&>(e[k])); };
+	BTIndexWalk::preorder(*this, visit, stack);
+}
+
+template<class T>
+template<class Elem, class F>
+void SoABinaryTree<T>::walk_inorder(F& f, TraversalStack& stack) const
+{
+	T *e = const_cast<T*>(elems.data());
+	auto visit = [&f, e](Handle k) { f(static_cast<Elem&>(e[k])); };
+	BTIndexWalk::inorder(*this, visit, stack);
+}
+
+template<class T>
+template<class Elem, class F>
+void SoABinaryTree<T>::walk_postorder(F& f, TraversalStack& stack) const
+{
+	T *e = const_cast<T*>(elems.data());
+	auto visit = [&f, e](Handle k) { f(static_cast<Elem&>(e[k])); };
+	BTIndexWalk::postorder(*this, visit, stack);
+}
+
+/*************/
+/* Operators */
+/*************/
+
+template<class T>
+bool SoABinaryTree<T>::operator==(const SoABinaryTree& src) const
+{
+	return BTIndexWalk::equal(*this, src);
+}
+
+/****************/
+/* Input/Output */
+/****************/
+
+template<class T>
+ostream& operator<<(ostream& out, const SoABinaryTree<T>& src)
+// Writes the elements by way of an inorder traversal
+{
+	BTIndexWalk::write(out, src);
+	return out;
+}
@@ -0,0 +1,137 @@
+#ifndef __SoABinaryTree_H
+#define __SoABinaryTree_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "BTIndexWalk.h"
+
+using namespace std;
+
+/****************************************************************************
+ *
+ * CLASS:  SoABinaryTree
+ *
+ ****************************************************************************/
+
+/* A 'SoABinaryTree' is a general binary tree stored as a structure of
+ * arrays: the elements in one array, and the left and right children in
+ * two arrays of 32-bit indices, with 0 for no child (as in
+ * 'CompactBinaryTree', index 0 is not a node).  Nodes are named by
+ * their index, a 'Handle'.
+ *
+ * The nodes of a tree are exactly the cells 1 ... node_count() of the
+ * arrays.  Aggregates that do not depend on the order of the nodes
+ * ('reduce', 'count_if', and 'node_count' and 'leaf_count' themselves)
+ * are therefore plain loops over an array, which the compiler can
+ * vectorize, instead of walks along the links.  The traversals still
+ * follow the links, in the index arrays.
+ *
+ * To keep the arrays free of holes, the shape is fixed when the tree is
+ * built (from a complete array, a sparse encoding or another tree); the
+ * elements can be changed in place.
+ */
+
+template <class T>
+class SoABinaryTree {
+ public:
+  typedef uint32_t Handle;
+
+  /* Construction */
+  SoABinaryTree() : elems(1), lefts(1), rights(1) {}
+  SoABinaryTree( T *elements, int n_elements );
+  SoABinaryTree( const vector<bool>& present, const vector<T>& elements );
+  template<class A>
+  explicit SoABinaryTree( const BinaryTree<T, A>& src );
+
+  /* Node handles: the root (0 if the tree is empty) and the parts of a
+   * node */
+  Handle root_node() const            { return elems.size() > 1 ? 1 : 0; }
+  const T& elem( Handle node ) const  { return elems[node]; }
+  T& elem( Handle node )              { return elems[node]; }
+  Handle left( Handle node ) const    { return lefts[node]; }
+  Handle right( Handle node ) const   { return rights[node]; }
+  bool is_leaf( Handle node ) const
+    { return lefts[node] == 0 && rights[node] == 0; }
+
+  /* Access and Tests */
+  bool is_empty() const      { return elems.size() == 1; }
+  int height() const;
+  int node_count() const     { return int(elems.size()) - 1; }
+  int leaf_count() const;
+  size_t hash() const;
+
+  /* Order-insensitive aggregates over the elements.  'reduce' combines
+   * 'init' and all the elements with 'op', in no particular order and
+   * grouping: 'op' must be associative and commutative, and 'init' must
+   * be its identity (0 for a sum, the largest value for a minimum...).
+   * 'count_if' counts the elements for which 'pred' holds. */
+  template<class R, class Op> R reduce( R init, Op op ) const;
+  template<class Pred> int count_if( Pred pred ) const;
+
+  /* Mutators, and other Initialization (see 'BinaryTree') */
+  bool empty_this();
+  void init_complete( T *elements, int n_elements );
+  int to_flat_array( T *elements, int max ) const;
+  void init_sparse( const vector<bool>& present, const vector<T>& elements );
+  int to_sparse_array( vector<bool>& present, vector<T>& elements ) const;
+
+  /* Replaces the contents of 'dest' by a copy of this tree */
+  template<class A>
+  void to_binary_tree( BinaryTree<T, A>& dest ) const;
+
+  /* Traversal, as in 'BinaryTree' */
+  typedef BTIndexWalk::Stack TraversalStack;
+
+  void preorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_preorder<const T>(f, stack); }
+  void inorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_inorder<const T>(f, stack); }
+  void postorder( void (*f)(const T&) ) const
+    { TraversalStack stack; walk_postorder<const T>(f, stack); }
+
+  template<class F> void preorder( F&& f ) const
+    { TraversalStack stack; walk_preorder<const T>(f, stack); }
+  template<class F> void inorder( F&& f ) const
+    { TraversalStack stack; walk_inorder<const T>(f, stack); }
+  template<class F> void postorder( F&& f ) const
+    { TraversalStack stack; walk_postorder<const T>(f, stack); }
+
+  template<class F> void preorder_mutable( F&& f )
+    { TraversalStack stack; walk_preorder<T>(f, stack); }
+  template<class F> void inorder_mutable( F&& f )
+    { TraversalStack stack; walk_inorder<T>(f, stack); }
+  template<class F> void postorder_mutable( F&& f )
+    { TraversalStack stack; walk_postorder<T>(f, stack); }
+
+  /* Operators */
+  bool operator==( const SoABinaryTree& src ) const;
+  bool operator!=( const SoABinaryTree& src ) const
+    { return !(*this == src); }
+
+  /* Input/Output */
+  template<class S>
+  friend ostream& operator<<( ostream& out, const SoABinaryTree<S>& src );
+
+
+ protected:
+  vector<T> elems;        // element of every node; 'elems[0]' is unused
+  vector<Handle> lefts;   // left child of every node (0 if none)
+  vector<Handle> rights;  // right child of every node (0 if none)
+
+  /* Iterative traversal engine; each element is passed to 'f' as an
+   * 'Elem&', where 'Elem' is either 'const T' or 'T' */
+  template<class Elem, class F>
+  void walk_preorder( F& f, TraversalStack& stack ) const;
+  template<class Elem, class F>
+  void walk_inorder( F& f, TraversalStack& stack ) const;
+  template<class Elem, class F>
+  void walk_postorder( F& f, TraversalStack& stack ) const;
+};
+
+
+#include "SoABinaryTree.cpp"
+
+#endif
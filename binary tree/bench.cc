@@ -0,0 +1,1282 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <fstream>
+#include <unordered_set>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "BinarySearchTree.h"
+#include "AVLTree.h"
+#include "BTFrozenTree.h"
+#include "BTKaryTree.h"
+#include "BTMappedTree.h"
+#include "CompactBinaryTree.h"
+#include "CompleteBinaryTree.h"
+#include "EytzingerTree.h"
+#include "PersistentBinaryTree.h"
+#include "SoABinaryTree.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Benchmarks for the tree implementations.  Run as
+ *
+ *   bench [name] [n]
+ *
+ * where 'name' selects one benchmark (all of them are run if it is
+ * omitted or "all") and 'n' is the number of tree nodes to use.
+ */
+
+static double elapsed( steady_clock::time_point start )
+  // Returns the number of milliseconds since 'start'
+{
+  return duration<double, milli>(steady_clock::now() - start).count();
+}
+
+static vector<int> make_elements( int n )
+  // Returns the array 0, 1, 2, ... n in complete-tree order (cell 0 unused)
+{
+  vector<int> elements(n + 1);
+  for (int k = 0; k <= n; k++)
+    elements[k] = k;
+  return elements;
+}
+
+/* A 'ShapedTree' can be built in shapes that 'init_complete' cannot
+ * produce, and exposes the protected recursive traversal helpers so
+ * that they can be timed against the public (iterative) traversals */
+class ShapedTree : public BinaryTree<int> {
+ public:
+  ShapedTree( BTNodeAllocator<BTNode<int> > *alloc = NULL )
+    : BinaryTree<int>(alloc) {}
+
+  using BinaryTree<int>::preorder;
+  using BinaryTree<int>::inorder;
+  using BinaryTree<int>::postorder;
+
+  BTNode<int> *get_root() const { return root; }
+
+  void init_path( int n )
+    // A degenerate tree: node 'k + 1' is the left child of node 'k'
+  {
+    empty_this();
+    for (int k = n; k >= 1; k--)
+      root = new_node(k, root);
+  }
+};
+
+
+/*******************/
+/* Node allocation */
+/*******************/
+
+static void bench_alloc( int n )
+  // Bulk build and teardown through the global heap versus a per-tree
+  // arena
+{
+  vector<int> elements = make_elements(n);
+  BTNodeHeap<BTNode<int> > heap;
+
+  for (int pass = 0; pass < 2; pass++) {
+    bool arena = (pass == 1);
+    BinaryTree<int> *tree = (arena ? new BinaryTree<int>
+                                   : new BinaryTree<int>(&heap));
+
+    steady_clock::time_point start = steady_clock::now();
+    tree->init_complete(&elements[0], n);
+    double t_build = elapsed(start);
+
+    start = steady_clock::now();
+    BinaryTree<int> copy(*tree);
+    double t_clone = elapsed(start);
+
+    start = steady_clock::now();
+    tree->empty_this();
+    double t_empty = elapsed(start);
+
+    cout << (arena ? "arena" : "heap ")
+         << "  init_complete " << t_build << " ms"
+         << "  clone " << t_clone << " ms"
+         << "  empty_this " << t_empty << " ms\n";
+    delete tree;
+  }
+}
+
+
+/*****************************/
+/* Implicit complete storage */
+/*****************************/
+
+static long long sum;
+
+static void add( const int& x ) { sum += x; }
+
+template <class Tree>
+static void bench_complete_tree( const char *label, vector<int>& elements,
+                                 int n )
+{
+  steady_clock::time_point start = steady_clock::now();
+  Tree tree(&elements[0], n);
+  double t_build = elapsed(start);
+
+  start = steady_clock::now();
+  int stats = tree.height() + tree.node_count() + tree.leaf_count();
+  double t_stats = elapsed(start);
+
+  vector<int> flat(n + 1);
+  start = steady_clock::now();
+  tree.to_flat_array(&flat[0], n);
+  double t_flat = elapsed(start);
+
+  sum = 0;
+  start = steady_clock::now();
+  tree.inorder(add);
+  double t_inorder = elapsed(start);
+
+  cout << label << "  build " << t_build << " ms"
+       << "  height+node_count+leaf_count " << t_stats << " ms"
+       << "  to_flat_array " << t_flat << " ms"
+       << "  inorder " << t_inorder << " ms"
+       << "  (" << stats + sum % 2 << ")\n";
+}
+
+static void bench_complete( int n )
+  // Linked nodes versus the pointer-free array layout
+{
+  vector<int> elements = make_elements(n);
+  bench_complete_tree<BinaryTree<int> >("BinaryTree        ", elements, n);
+  bench_complete_tree<CompleteBinaryTree<int> >("CompleteBinaryTree",
+                                                elements, n);
+}
+
+
+/*************/
+/* Traversal */
+/*************/
+
+static void time_traversals( const char *label, const ShapedTree& tree,
+                             bool recursive )
+{
+  ShapedTree::TraversalStack stack;
+  double t[3];
+  for (int order = 0; order < 3; order++) {
+    sum = 0;
+    steady_clock::time_point start = steady_clock::now();
+    if (recursive) {
+      if (order == 0) tree.preorder(add, tree.get_root());
+      if (order == 1) tree.inorder(add, tree.get_root());
+      if (order == 2) tree.postorder(add, tree.get_root());
+    }
+    else {
+      if (order == 0) tree.preorder(add, stack);
+      if (order == 1) tree.inorder(add, stack);
+      if (order == 2) tree.postorder(add, stack);
+    }
+    t[order] = elapsed(start);
+  }
+  cout << label << (recursive ? "  recursive" : "  iterative")
+       << "  preorder " << t[0] << " ms"
+       << "  inorder " << t[1] << " ms"
+       << "  postorder " << t[2] << " ms\n";
+}
+
+static void bench_traverse( int n )
+  // Recursive versus iterative traversals on a balanced tree and on a
+  // path; the recursive ones only get a path short enough not to
+  // overflow the call stack
+{
+  vector<int> elements = make_elements(n);
+  ShapedTree tree;
+  tree.init_complete(&elements[0], n);
+  time_traversals("balanced", tree, true);
+  time_traversals("balanced", tree, false);
+
+  int n_path = min(n, 1 << 16);
+  tree.init_path(n_path);
+  cout << "path of " << n_path << " nodes:\n";
+  time_traversals("path    ", tree, true);
+  time_traversals("path    ", tree, false);
+
+  tree.init_path(n);
+  cout << "path of " << n << " nodes:\n";
+  time_traversals("path    ", tree, false);
+}
+
+
+/************/
+/* Visitors */
+/************/
+
+struct Adder {
+  long long total;
+  Adder() : total(0) {}
+  void operator()( const int& x ) { total += x; }
+};
+
+static void bench_visitor( int n )
+  // A function pointer versus callables the compiler can inline
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+
+  sum = 0;
+  steady_clock::time_point start = steady_clock::now();
+  tree.inorder(add);
+  cout << "function pointer  " << elapsed(start) << " ms  (" << sum << ")\n";
+
+  long long total = 0;
+  start = steady_clock::now();
+  tree.inorder([&total](const int& x) { total += x; });
+  cout << "lambda            " << elapsed(start) << " ms  (" << total << ")\n";
+
+  Adder adder;
+  start = steady_clock::now();
+  tree.inorder(adder);
+  cout << "function object   " << elapsed(start) << " ms  ("
+       << adder.total << ")\n";
+
+  start = steady_clock::now();
+  tree.inorder_mutable([](int& x) { x++; });
+  cout << "mutable lambda    " << elapsed(start) << " ms\n";
+}
+
+
+/*************/
+/* Iterators */
+/*************/
+
+static void bench_iterator( int n )
+  // Searching for an element near the start of the inorder sequence:
+  // 'find' over the iterator stops there, a callback traversal cannot
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+  int target = *++++tree.begin();  // the third element inorder
+
+  steady_clock::time_point start = steady_clock::now();
+  bool found = false;
+  tree.inorder([&found, target](const int& x) {
+    if (x == target)
+      found = true;
+  });
+  cout << "inorder callback   " << elapsed(start) << " ms  (" << found << ")\n";
+
+  start = steady_clock::now();
+  found = (find(tree.begin(), tree.end(), target) != tree.end());
+  cout << "find over iterator " << elapsed(start) << " ms  (" << found << ")\n";
+
+  start = steady_clock::now();
+  long long total = 0;
+  for (int x : tree)
+    total += x;
+  cout << "full range-for     " << elapsed(start) << " ms  (" << total << ")\n";
+
+  start = steady_clock::now();
+  total = 0;
+  for (BinaryTree<int>::levelorder_iterator it = tree.levelorder_begin();
+       it != tree.levelorder_end(); ++it)
+    total += *it;
+  cout << "full level order   " << elapsed(start) << " ms  (" << total << ")\n";
+}
+
+
+/*********************/
+/* Morris traversals */
+/*********************/
+
+static void bench_morris( int n )
+  // Morris threading versus the recursive and stack-based inorder
+{
+  vector<int> elements = make_elements(n);
+  ShapedTree tree;
+  tree.init_complete(&elements[0], n);
+
+  for (int shape = 0; shape < 2; shape++) {
+    if (shape == 1)
+      tree.init_path(min(n, 1 << 16));
+    const char *label = (shape == 0 ? "balanced" : "path    ");
+
+    sum = 0;
+    steady_clock::time_point start = steady_clock::now();
+    tree.inorder(add, tree.get_root());
+    cout << label << "  recursive inorder " << elapsed(start) << " ms";
+
+    start = steady_clock::now();
+    tree.inorder(add);
+    cout << "  iterative inorder " << elapsed(start) << " ms";
+
+    start = steady_clock::now();
+    tree.morris_inorder(add);
+    cout << "  morris_inorder " << elapsed(start) << " ms";
+
+    start = steady_clock::now();
+    tree.morris_preorder(add);
+    cout << "  morris_preorder " << elapsed(start) << " ms"
+         << "  (" << sum << ")\n";
+  }
+}
+
+
+/***********************/
+/* Parallel reductions */
+/***********************/
+
+static void bench_parallel( int n )
+  // Serial statistics versus the work-stealing versions, for 1, 2, 4 ...
+  // threads up to the number of hardware threads
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+
+  steady_clock::time_point start = steady_clock::now();
+  int result = tree.height() + tree.node_count() + tree.leaf_count();
+  cout << "serial      " << elapsed(start) << " ms  (" << result << ")\n";
+
+  int max_threads = max(1u, thread::hardware_concurrency());
+  for (int threads = 1; ; threads = min(2 * threads, max_threads)) {
+    BTThreadPool pool(threads);
+    start = steady_clock::now();
+    result = tree.height(pool) + tree.node_count(pool) + tree.leaf_count(pool);
+    cout << threads << " thread(s) " << elapsed(start) << " ms  ("
+         << result << ")\n";
+    if (threads == max_threads)
+      break;
+  }
+}
+
+
+/************************/
+/* Augmented statistics */
+/************************/
+
+template <class Tree>
+static void bench_augment_tree( const char *label, vector<int>& elements,
+                                int n )
+{
+  steady_clock::time_point start = steady_clock::now();
+  Tree tree(&elements[0], n);
+  double t_build = elapsed(start);
+
+  start = steady_clock::now();
+  int stats = tree.height() + tree.node_count();
+  double t_stats = elapsed(start);
+
+  start = steady_clock::now();
+  long long total = 0;
+  for (int k = 0; k < n; k += max(1, n/100))
+    total += tree.select(k);
+  double t_select = elapsed(start);
+
+  cout << label << "  build " << t_build << " ms"
+       << "  height+node_count " << t_stats << " ms"
+       << "  100 x select " << t_select << " ms"
+       << "  (" << stats + total % 2 << ")\n";
+}
+
+static void bench_augment( int n )
+  // Plain nodes versus nodes with cached subtree size and height
+{
+  vector<int> elements = make_elements(n);
+  bench_augment_tree<BinaryTree<int> >("BTNoAugment   ", elements, n);
+  bench_augment_tree<BinaryTree<int, BTSubtreeStats> >("BTSubtreeStats",
+                                                       elements, n);
+}
+
+
+/*****************/
+/* Copy and move */
+/*****************/
+
+static void bench_assign( int n )
+  // Copy construction, copy assignment over a tree of the same shape
+  // (which reuses its nodes), and moves
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+
+  steady_clock::time_point start = steady_clock::now();
+  BinaryTree<int> copy(tree);
+  cout << "copy constructor             " << elapsed(start) << " ms\n";
+
+  start = steady_clock::now();
+  copy = tree;
+  cout << "copy assignment (same shape) " << elapsed(start) << " ms\n";
+
+  start = steady_clock::now();
+  BinaryTree<int> moved(std::move(copy));
+  cout << "move constructor             " << elapsed(start) << " ms\n";
+
+  vector<BinaryTree<int> > trees;
+  start = steady_clock::now();
+  for (int k = 0; k < 8; k++)
+    trees.push_back(BinaryTree<int>(&elements[0], n/8));
+  cout << "8 trees into a vector        " << elapsed(start) << " ms  ("
+       << trees.back().node_count() << ")\n";
+}
+
+
+/************/
+/* Teardown */
+/************/
+
+static void bench_teardown( int n )
+  // Freeing a heap-allocated tree node by node, on a balanced tree and
+  // on a path (which the old recursive teardown could not handle), and
+  // handing an arena tree to a background reclaimer
+{
+  vector<int> elements = make_elements(n);
+  BTNodeHeap<BTNode<int> > heap;
+
+  for (int shape = 0; shape < 2; shape++) {
+    ShapedTree heap_tree(&heap);
+    if (shape == 0)
+      heap_tree.init_complete(&elements[0], n);
+    else
+      heap_tree.init_path(n);
+    steady_clock::time_point start = steady_clock::now();
+    heap_tree.empty_this();
+    cout << (shape == 0 ? "balanced" : "path    ")
+         << "  heap empty_this " << elapsed(start) << " ms\n";
+  }
+
+  BTReclaimer reclaimer;
+  BinaryTree<int> arena_tree(&elements[0], n);
+  steady_clock::time_point start = steady_clock::now();
+  arena_tree.empty_this(reclaimer);
+  cout << "balanced  arena empty_this(reclaimer) " << elapsed(start)
+       << " ms";
+  start = steady_clock::now();
+  reclaimer.drain();
+  cout << "  (background work " << elapsed(start) << " ms)\n";
+}
+
+
+/******************/
+/* Merkle hashing */
+/******************/
+
+template <class Tree>
+static void bench_hash_tree( const char *label, vector<int>& elements,
+                             vector<int>& changed, int n )
+{
+  steady_clock::time_point start = steady_clock::now();
+  Tree a(&elements[0], n), b(&elements[0], n), c(&changed[0], n);
+  double t_build = elapsed(start);
+
+  start = steady_clock::now();
+  bool equal = (a == b);
+  double t_equal = elapsed(start);
+
+  start = steady_clock::now();
+  bool unequal = (a != c);
+  double t_unequal = elapsed(start);
+
+  start = steady_clock::now();
+  bool verified = a.equals(b, true);
+  double t_verify = elapsed(start);
+
+  start = steady_clock::now();
+  size_t h = a.hash();
+  double t_hash = elapsed(start);
+
+  cout << label << "  build 3 trees " << t_build << " ms"
+       << "  equal pair " << t_equal << " ms"
+       << "  unequal pair " << t_unequal << " ms"
+       << "  equals(verify) " << t_verify << " ms"
+       << "  hash() " << t_hash << " ms"
+       << "  (" << equal << unequal << verified << h % 2 << ")\n";
+}
+
+static void bench_hash( int n )
+  // Comparing large trees with and without hashes in the nodes; the
+  // unequal pair differs only in the rightmost node of the last full
+  // level, which a node-by-node comparison reaches near the end
+{
+  vector<int> elements = make_elements(n), changed = make_elements(n);
+  int rightmost = 1;
+  while (2 * rightmost + 1 <= n)
+    rightmost = 2 * rightmost + 1;
+  changed[rightmost] = -1;
+  bench_hash_tree<BinaryTree<int> >("BTNoAugment  ", elements, changed, n);
+  bench_hash_tree<BinaryTree<int, BTSubtreeHash> >("BTSubtreeHash",
+                                                   elements, changed, n);
+}
+
+
+/******************/
+/* Parallel clone */
+/******************/
+
+static void bench_pclone( int n )
+  // The copy constructor versus the parallel clone for 1, 2, 4 ...
+  // threads up to the number of hardware threads
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+
+  steady_clock::time_point start = steady_clock::now();
+  BinaryTree<int> serial(tree);
+  double t_serial = elapsed(start);
+  cout << "copy constructor " << t_serial << " ms\n";
+
+  int max_threads = max(1u, thread::hardware_concurrency());
+  for (int threads = 1; ; threads = min(2 * threads, max_threads)) {
+    BTThreadPool pool(threads);
+    start = steady_clock::now();
+    BinaryTree<int> copy(tree, pool);
+    double t = elapsed(start);
+    bool equal = copy.equals(tree, true);
+    cout << threads << " thread(s)      " << t << " ms  (speedup "
+         << t_serial / t << (equal ? ", equal)\n" : ", DIFFERENT)\n");
+    if (threads == max_threads)
+      break;
+  }
+}
+
+
+/********************/
+/* Persistent trees */
+/********************/
+
+class SharedTree : public PersistentBinaryTree<int> {
+ public:
+  SharedTree( int *elements, int n ) : PersistentBinaryTree<int>(elements, n) {}
+  const Node *get_root() const { return root; }
+};
+
+static void bench_persistent( int n )
+  // Many versions of one tree, each changing a single element of the
+  // previous one: the time to make them and the number of distinct
+  // nodes they use, against full copies
+{
+  const int n_versions = 1000;
+  vector<int> elements = make_elements(n);
+  SharedTree base(&elements[0], n);
+
+  steady_clock::time_point start = steady_clock::now();
+  vector<SharedTree> versions(1, base);
+  for (int k = 1; k <= n_versions; k++) {
+    versions.push_back(versions.back());
+    versions.back().set(1 + (k * 7919) % n, -k);
+  }
+  double t_versions = elapsed(start);
+
+  // count the nodes reachable from any version, skipping the subtrees
+  // already counted
+  unordered_set<const SharedTree::Node*> seen;
+  vector<const SharedTree::Node*> pending;
+  for (size_t k = 0; k < versions.size(); k++) {
+    pending.push_back(versions[k].get_root());
+    while (!pending.empty()) {
+      const SharedTree::Node *node = pending.back();
+      pending.pop_back();
+      if (node && seen.insert(node).second) {
+        pending.push_back(node->left);
+        pending.push_back(node->right);
+      }
+    }
+  }
+
+  BinaryTree<int> tree(&elements[0], n);
+  start = steady_clock::now();
+  BinaryTree<int> copy(tree);
+  double t_copy = elapsed(start);
+
+  cout << n_versions << " versions    " << t_versions << " ms, "
+       << seen.size() << " distinct nodes\n";
+  cout << n_versions << " full copies ~" << n_versions * t_copy << " ms, "
+       << (long long) n_versions * n << " nodes\n";
+}
+
+
+/*********************/
+/* Interned subtrees */
+/*********************/
+
+static void bench_intern_data( const char *label, vector<int>& elements,
+                               int n )
+{
+  typedef PersistentBinaryTree<int>::Node Node;
+  BTInterner<int> interner;
+
+  steady_clock::time_point start = steady_clock::now();
+  PersistentBinaryTree<int> plain(&elements[0], n), plain2(&elements[0], n);
+  double t_plain = elapsed(start);
+  start = steady_clock::now();
+  PersistentBinaryTree<int> interned(&elements[0], n, interner),
+    interned2(&elements[0], n, interner);
+  double t_interned = elapsed(start);
+
+  start = steady_clock::now();
+  bool equal = (plain == plain2);
+  double t_compare_plain = elapsed(start);
+  start = steady_clock::now();
+  equal = equal && (interned == interned2);
+  double t_compare_interned = elapsed(start);
+
+  BTInternStats stats = interner.stats();
+  cout << label << " build " << t_plain << " / " << t_interned
+       << " ms (plain / interned), compare " << t_compare_plain << " / "
+       << t_compare_interned << " ms" << (equal ? "" : " DIFFERENT") << "\n"
+       << "               " << stats.distinct << " distinct nodes, dedup "
+       << stats.dedup_ratio() << "x, "
+       << 2.0 * n * sizeof(Node) / (1 << 20) << " / "
+       << double(stats.distinct) * sizeof(Node) / (1 << 20) << " MB\n";
+}
+
+static void bench_intern( int n )
+  // Building, comparing and storing two equal trees with and without
+  // interning, for data with more and less repetition
+{
+  vector<int> elements = make_elements(n);
+  for (int k = 1; k <= n; k++) {
+    int level = 0;
+    while ((k >> level) > 1)
+      level++;
+    elements[k] = level;
+  }
+  bench_intern_data("by level     ", elements, n);
+
+  unsigned state = 12345;
+  for (int k = 1; k <= n; k++) {
+    state = state * 1103515245 + 12345;
+    elements[k] = (state >> 16) & 1;
+  }
+  bench_intern_data("random bits  ", elements, n);
+}
+
+
+/*************************/
+/* Sparse array encoding */
+/*************************/
+
+static void bench_sparse_tree( const char *label, const BinaryTree<int>& tree,
+                               long long flat_cells )
+  // Writes 'tree' both ways (the flat array, allocation included, only
+  // if 'flat_cells' is within reach) and reads the sparse encoding back
+{
+  cout << label;
+  if (flat_cells < (1LL << 30)) {
+    steady_clock::time_point start = steady_clock::now();
+    vector<int> flat(flat_cells + 1);
+    tree.to_flat_array(&flat[0], int(flat_cells));
+    cout << "flat " << elapsed(start) << " ms, "
+         << double(flat.size()) * sizeof(int) / 1024 << " KB; ";
+  } else
+    cout << "flat needs 2^" << int(log2(double(flat_cells))) << " cells; ";
+
+  vector<bool> present;
+  vector<int> elements;
+  steady_clock::time_point start = steady_clock::now();
+  tree.to_sparse_array(present, elements);
+  double t_write = elapsed(start);
+  start = steady_clock::now();
+  BinaryTree<int> copy(present, elements);
+  double t_read = elapsed(start);
+  cout << "sparse " << t_write << " ms (read " << t_read << " ms), "
+       << (elements.size() * sizeof(int) + present.size() / 8.0) / 1024
+       << " KB\n";
+}
+
+static void bench_sparse( int n )
+  // The complete-tree array against the sparse level-order encoding, for
+  // a complete tree and for degenerate paths of increasing depth
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> complete(&elements[0], n);
+  bench_sparse_tree("complete      ", complete, n);
+
+  ShapedTree path;
+  for (int depth = 8; depth <= 24; depth += 8) {
+    path.init_path(depth);
+    cout << "path, depth " << depth << (depth < 10 ? "  " : " ");
+    bench_sparse_tree("", path, 1LL << (depth - 1));
+  }
+  path.init_path(n);
+  bench_sparse_tree("path, depth n ", path, 1LL << 62);
+}
+
+
+/********************/
+/* Mapped tree file */
+/********************/
+
+static void bench_mapped( int n )
+  // Loading a saved tree: reading the elements and rebuilding it with
+  // 'init_complete', against mapping the file; both then traverse it
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+  const char *path = "bench_tree.bt";
+
+  steady_clock::time_point start = steady_clock::now();
+  BTMappedTree<int>::write(tree, path);
+  cout << "write           " << elapsed(start) << " ms\n";
+
+  start = steady_clock::now();
+  {
+    ifstream in(path, ios::binary);
+    BTFileHeader header;
+    in.read((char*) &header, sizeof(header));
+    vector<int> loaded(header.node_count + 1);
+    in.seekg(header.elem_offset);
+    in.read((char*) &loaded[1], header.node_count * sizeof(int));
+    BinaryTree<int> rebuilt(&loaded[0], int(header.node_count));
+    double t_load = elapsed(start);
+    sum = 0;
+    rebuilt.inorder(add);
+    cout << "read + rebuild  " << t_load << " ms, first inorder walk "
+         << elapsed(start) - t_load << " ms\n";
+  }
+
+  start = steady_clock::now();
+  BTMappedTree<int> mapped;
+  mapped.open(path);
+  double t_open = elapsed(start);
+  long long rebuilt_sum = sum;
+  sum = 0;
+  mapped.inorder(add);
+  cout << "mmap            " << t_open << " ms, first inorder walk "
+       << elapsed(start) - t_open << " ms"
+       << (sum == rebuilt_sum ? "\n" : " (DIFFERENT)\n");
+  mapped.close();
+  remove(path);
+}
+
+
+/*************************/
+/* Streaming from a file */
+/*************************/
+
+static void bench_stream( int n )
+  // Loading a tree file by reading the whole element array first, as
+  // the array constructor needs, against the streaming readers
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+  const char *complete_path = "bench_complete.bin";
+  const char *preorder_path = "bench_preorder.bin";
+  {
+    ofstream complete_out(complete_path, ios::binary);
+    ofstream preorder_out(preorder_path, ios::binary);
+    tree.write_complete(complete_out);
+    tree.write_preorder(preorder_out);
+  }
+
+  steady_clock::time_point start = steady_clock::now();
+  {
+    ifstream in(complete_path, ios::binary);
+    vector<int> loaded(n + 1);
+    in.read((char*) &loaded[1], n * sizeof(int));
+    BinaryTree<int> built(&loaded[0], n);
+    double t = elapsed(start);
+    cout << "array + constructor " << t << " ms, "
+         << n * sizeof(int) / 1024 << " KB buffered"
+         << (built == tree ? "\n" : " (DIFFERENT)\n");
+  }
+
+  start = steady_clock::now();
+  {
+    ifstream in(complete_path, ios::binary);
+    BinaryTree<int> built;
+    built.read_complete(in);
+    double t = elapsed(start);
+    cout << "read_complete       " << t << " ms, 64 KB buffered"
+         << (built == tree ? "\n" : " (DIFFERENT)\n");
+  }
+
+  start = steady_clock::now();
+  {
+    ifstream in(preorder_path, ios::binary);
+    BinaryTree<int> built;
+    built.read_preorder(in);
+    double t = elapsed(start);
+    cout << "read_preorder       " << t << " ms, 64 KB buffered"
+         << (built == tree ? "\n" : " (DIFFERENT)\n");
+  }
+  remove(complete_path);
+  remove(preorder_path);
+}
+
+
+/**************************************/
+/* Construction from traversal orders */
+/**************************************/
+
+static bool same_traversals( const BinaryTree<int>& a,
+                             const BinaryTree<int>& b )
+  // Trees with distinct elements are equal if their preorder and inorder
+  // sequences are; unlike '==' this does not recurse, so deep trees work
+{
+  return equal(a.preorder_begin(), a.preorder_end(), b.preorder_begin())
+         && equal(a.inorder_begin(), a.inorder_end(), b.inorder_begin());
+}
+
+static void bench_rebuild_tree( const char *label, const ShapedTree& tree,
+                                int n )
+{
+  vector<int> pre, in, post;
+  pre.reserve(n);
+  in.reserve(n);
+  post.reserve(n);
+  tree.preorder([&pre](const int& x) { pre.push_back(x); });
+  tree.inorder([&in](const int& x) { in.push_back(x); });
+  tree.postorder([&post](const int& x) { post.push_back(x); });
+
+  BinaryTree<int> rebuilt;
+  steady_clock::time_point start = steady_clock::now();
+  bool ok = rebuilt.init_preorder_inorder(pre, in);
+  double t_pre = elapsed(start);
+  ok = ok && same_traversals(rebuilt, tree);
+  start = steady_clock::now();
+  ok = ok && rebuilt.init_postorder_inorder(post, in);
+  double t_post = elapsed(start);
+  ok = ok && same_traversals(rebuilt, tree);
+  cout << label << "preorder + inorder " << t_pre << " ms, postorder + "
+       << "inorder " << t_post << " ms" << (ok ? "\n" : " (DIFFERENT)\n");
+}
+
+static void bench_rebuild( int n )
+  // Rebuilding trees from their traversal sequences, against building
+  // the complete tree from its array; the deep path shows that no
+  // recursion is involved (run it with n = 10000000 for 10M nodes)
+{
+  vector<int> elements = make_elements(n);
+  ShapedTree tree;
+  steady_clock::time_point start = steady_clock::now();
+  tree.init_complete(&elements[0], n);
+  cout << "complete: init_complete " << elapsed(start) << " ms\n";
+  bench_rebuild_tree("complete: ", tree, n);
+  tree.init_path(n);
+  bench_rebuild_tree("path:     ", tree, n);
+}
+
+
+/***********************/
+/* Binary search trees */
+/***********************/
+
+static void bench_search( int n )
+  // Lookups of random keys (half of them present) in a bulk-loaded
+  // search tree, a 'std::set' and a sorted array with binary search
+{
+  const int n_queries = 1 << 22;
+  vector<int> sorted(n), queries(n_queries);
+  for (int k = 0; k < n; k++)
+    sorted[k] = 2 * k;
+  unsigned state = 12345;
+  for (int k = 0; k < n_queries; k++) {
+    state = state * 1103515245 + 12345;
+    queries[k] = int(((long long) state * 2 * n) >> 32);
+  }
+
+  steady_clock::time_point start = steady_clock::now();
+  BinarySearchTree<int> tree(sorted.data(), n);
+  double t_tree = elapsed(start);
+  start = steady_clock::now();
+  set<int> std_set(sorted.begin(), sorted.end());
+  double t_set = elapsed(start);
+  cout << "build: init_sorted " << t_tree << " ms, std::set " << t_set
+       << " ms\n";
+
+  start = steady_clock::now();
+  long long hits = 0;
+  for (int k = 0; k < n_queries; k++)
+    hits += tree.contains(queries[k]);
+  double t = elapsed(start);
+  cout << "BinarySearchTree " << n_queries / t / 1000 << " M lookups/s ("
+       << hits << " hits)\n";
+
+  start = steady_clock::now();
+  hits = 0;
+  for (int k = 0; k < n_queries; k++)
+    hits += std_set.count(queries[k]);
+  t = elapsed(start);
+  cout << "std::set         " << n_queries / t / 1000 << " M lookups/s ("
+       << hits << " hits)\n";
+
+  start = steady_clock::now();
+  hits = 0;
+  for (int k = 0; k < n_queries; k++)
+    hits += binary_search(sorted.begin(), sorted.end(), queries[k]);
+  t = elapsed(start);
+  cout << "sorted array     " << n_queries / t / 1000 << " M lookups/s ("
+       << hits << " hits)\n";
+}
+
+
+/*************/
+/* AVL trees */
+/*************/
+
+template<class Tree>
+static void bench_avl_tree( const char *label, const vector<int>& keys,
+                            const vector<int>& queries )
+  // Inserts 'keys' one by one, then looks up 'queries'
+{
+  Tree tree;
+  steady_clock::time_point start = steady_clock::now();
+  for (size_t k = 0; k < keys.size(); k++)
+    tree.insert(keys[k]);
+  double t_insert = elapsed(start);
+  start = steady_clock::now();
+  long long hits = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    hits += tree.count(queries[k]);
+  double t_find = elapsed(start);
+  cout << label << keys.size() / t_insert / 1000 << " M inserts/s, "
+       << queries.size() / t_find / 1000 << " M lookups/s (" << hits
+       << " hits)\n";
+}
+
+template<class Tree>
+class CountingTree : public Tree {
+  // Gives the search trees the 'count' of 'std::set'
+ public:
+  size_t count( const int& x ) const { return this->contains(x); }
+};
+
+static void bench_avl( int n )
+  // Insertions of sorted and random keys into an unbalanced search tree,
+  // an AVL tree and a 'std::set', then random lookups.  The unbalanced
+  // tree degenerates into a path for sorted keys, at O(n) per
+  // operation, so it only gets a small share of them
+{
+  vector<int> sorted(n), shuffled(n), queries(1 << 20);
+  for (int k = 0; k < n; k++)
+    sorted[k] = shuffled[k] = 2 * k;
+  unsigned state = 12345;
+  for (int k = n - 1; k > 0; k--) {
+    state = state * 1103515245 + 12345;
+    swap(shuffled[k], shuffled[(state >> 8) % (k + 1)]);
+  }
+  for (size_t k = 0; k < queries.size(); k++) {
+    state = state * 1103515245 + 12345;
+    queries[k] = int(((long long) state * 2 * n) >> 32);
+  }
+
+  int few = min(n, 1 << 14);
+  vector<int> few_sorted(sorted.begin(), sorted.begin() + few);
+  vector<int> few_queries(queries.begin(), queries.begin() + few);
+  for (int k = 0; k < few; k++)
+    few_queries[k] %= 2 * few;
+  bench_avl_tree<CountingTree<BinarySearchTree<int> > >(
+    "sorted, unbalanced (small n) ", few_sorted, few_queries);
+  bench_avl_tree<CountingTree<AVLTree<int> > >(
+    "sorted, AVL         (small n) ", few_sorted, few_queries);
+  bench_avl_tree<CountingTree<AVLTree<int> > >(
+    "sorted, AVL                   ", sorted, queries);
+  bench_avl_tree<set<int> >("sorted, std::set              ", sorted,
+                            queries);
+  bench_avl_tree<CountingTree<BinarySearchTree<int> > >(
+    "random, unbalanced            ", shuffled, queries);
+  bench_avl_tree<CountingTree<AVLTree<int> > >(
+    "random, AVL                   ", shuffled, queries);
+  bench_avl_tree<set<int> >("random, std::set              ", shuffled,
+                            queries);
+}
+
+
+/***********************/
+/* Frozen tree layouts */
+/***********************/
+
+template<class Tree>
+static double lookups_per_us( const Tree& tree, const vector<int>& queries,
+                              long long& hits )
+{
+  steady_clock::time_point start = steady_clock::now();
+  hits = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    hits += tree.contains(queries[k]);
+  return queries.size() / elapsed(start) / 1000;
+}
+
+static void bench_layout( int n )
+  // Random lookups in a balanced search tree with its nodes where the
+  // allocator put them, and in frozen copies in level order and in van
+  // Emde Boas order, for sizes from 1M up to 'n' (run it with a larger
+  // 'n' for larger trees, memory permitting)
+{
+  vector<int> queries(1 << 22);
+  for (int size = min(n, 1 << 20); ; size = min(4 * size, n)) {
+    vector<int> sorted(size);
+    for (int k = 0; k < size; k++)
+      sorted[k] = 2 * k;
+    unsigned state = 12345;
+    for (size_t k = 0; k < queries.size(); k++) {
+      state = state * 1103515245 + 12345;
+      queries[k] = int(((long long) state * 2 * size) >> 32);
+    }
+
+    BinarySearchTree<int> tree(sorted.data(), size);
+    steady_clock::time_point start = steady_clock::now();
+    BTFrozenTree<int> bfs(tree, BTLayoutBFS);
+    double t_bfs = elapsed(start);
+    start = steady_clock::now();
+    BTFrozenTree<int> veb(tree, BTLayoutVEB);
+    double t_veb = elapsed(start);
+
+    long long hits_tree, hits_bfs, hits_veb;
+    double r_tree = lookups_per_us(tree, queries, hits_tree);
+    double r_bfs = lookups_per_us(bfs, queries, hits_bfs);
+    double r_veb = lookups_per_us(veb, queries, hits_veb);
+    cout << size << " nodes: pointers " << r_tree << ", BFS " << r_bfs
+         << ", vEB " << r_veb << " M lookups/s"
+         << (hits_tree == hits_bfs && hits_bfs == hits_veb ? "" : " (DIFFERENT)")
+         << "; freeze BFS " << t_bfs << " ms, vEB " << t_veb << " ms\n";
+    if (size == n)
+      break;
+  }
+}
+
+
+/********************/
+/* Eytzinger search */
+/********************/
+
+static void bench_eytzinger( int n )
+  // lower_bound of random keys: 'std::lower_bound' on the sorted array,
+  // the Eytzinger search one query at a time, and in batches
+{
+  vector<int> sorted(n), queries(1 << 22), results(queries.size());
+  for (int k = 0; k < n; k++)
+    sorted[k] = 2 * k;
+  unsigned state = 12345;
+  for (size_t k = 0; k < queries.size(); k++) {
+    state = state * 1103515245 + 12345;
+    // below the largest element, so every search has a result
+    queries[k] = int(((long long) state * (2 * n - 1)) >> 32);
+  }
+  EytzingerTree<int> tree(sorted.data(), n);
+
+  steady_clock::time_point start = steady_clock::now();
+  long long total = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    total += *std::lower_bound(sorted.begin(), sorted.end(), queries[k]);
+  double t = elapsed(start);
+  cout << "std::lower_bound " << queries.size() / t / 1000 << " M/s\n";
+
+  start = steady_clock::now();
+  long long total_single = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    total_single += *tree.lower_bound(queries[k]);
+  t = elapsed(start);
+  cout << "Eytzinger        " << queries.size() / t / 1000 << " M/s"
+       << (total_single == total ? "\n" : " (DIFFERENT)\n");
+
+  start = steady_clock::now();
+  tree.lower_bound_batch(queries.data(), int(queries.size()), results.data());
+  long long total_batch = 0;
+  for (size_t k = 0; k < results.size(); k++)
+    total_batch += tree[results[k]];
+  t = elapsed(start);
+  cout << "Eytzinger, batch " << queries.size() / t / 1000 << " M/s"
+       << (total_batch == total ? "\n" : " (DIFFERENT)\n");
+}
+
+
+
+/****************/
+/* K-ary search */
+/****************/
+
+static void bench_kary( int n )
+  // lower_bound of random keys: the pointer search tree, the Eytzinger
+  // search, and the 16-key nodes at each SIMD level the machine has
+{
+  vector<int> sorted(n), queries(1 << 22);
+  for (int k = 0; k < n; k++)
+    sorted[k] = 2 * k;
+  unsigned state = 12345;
+  for (size_t k = 0; k < queries.size(); k++) {
+    state = state * 1103515245 + 12345;
+    // below the largest element, so every search has a result
+    queries[k] = int(((long long) state * (2 * n - 1)) >> 32);
+  }
+  BinarySearchTree<int> bst(sorted.data(), n);
+  EytzingerTree<int> eytzinger(sorted.data(), n);
+  BTKaryTree<int> kary(bst);
+
+  steady_clock::time_point start = steady_clock::now();
+  long long total = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    total += *bst.lower_bound(queries[k]);
+  double t = elapsed(start);
+  cout << "pointer BST " << queries.size() / t / 1000 << " M/s\n";
+
+  start = steady_clock::now();
+  long long total_eytzinger = 0;
+  for (size_t k = 0; k < queries.size(); k++)
+    total_eytzinger += *eytzinger.lower_bound(queries[k]);
+  t = elapsed(start);
+  cout << "Eytzinger   " << queries.size() / t / 1000 << " M/s"
+       << (total_eytzinger == total ? "\n" : " (DIFFERENT)\n");
+
+  const char *names[] = { "k-ary, C++ ", "k-ary, SSE2", "k-ary, AVX2" };
+  BTSimdLevel best = kary.simd();
+  for (int level = BTSimdScalar; level <= best; level++) {
+    kary.set_simd(BTSimdLevel(level));
+    start = steady_clock::now();
+    long long total_kary = 0;
+    for (size_t k = 0; k < queries.size(); k++) {
+      int found = 0;
+      kary.lower_bound(queries[k], found);
+      total_kary += found;
+    }
+    t = elapsed(start);
+    cout << names[level] << " " << queries.size() / t / 1000 << " M/s"
+         << (total_kary == total ? "\n" : " (DIFFERENT)\n");
+  }
+}
+
+
+/*****************/
+/* Compact nodes */
+/*****************/
+
+static size_t node_bytes( const BinaryTree<int>&, int n )
+  { return size_t(n) * sizeof(BTNode<int>); }
+static size_t node_bytes( const CompactBinaryTree<int>& tree, int )
+  { return tree.bytes_reserved(); }
+
+template<class Tree>
+static void bench_compact_tree( const char *label, vector<int>& elements,
+                                int n )
+{
+  steady_clock::time_point start = steady_clock::now();
+  Tree tree(&elements[0], n);
+  double t_build = elapsed(start);
+
+  sum = 0;
+  start = steady_clock::now();
+  tree.preorder(add);
+  double t_preorder = elapsed(start);
+
+  long long total = 0;
+  start = steady_clock::now();
+  for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+    total += *it;
+  double t_iterator = elapsed(start);
+
+  cout << label << "  nodes " << double(node_bytes(tree, n)) / (1 << 20)
+       << " MB"
+       << "  build " << t_build << " ms"
+       << "  preorder " << t_preorder << " ms"
+       << "  iterator " << t_iterator << " ms"
+       << (total == sum ? "\n" : " (DIFFERENT)\n");
+}
+
+static void bench_compact( int n )
+  // Pointer nodes versus 32-bit index nodes, on a complete tree: the
+  // size of the node storage, and the speed of a build and of two walks
+  // (try n = 100000000)
+{
+  vector<int> elements = make_elements(n);
+  bench_compact_tree<BinaryTree<int> >("BinaryTree       ", elements, n);
+  bench_compact_tree<CompactBinaryTree<int> >("CompactBinaryTree",
+                                              elements, n);
+}
+
+
+/**************/
+/* Aggregates */
+/**************/
+
+static void bench_aggregate( int n )
+  // A sum and a count over all the elements: by a preorder traversal of
+  // the linked tree and of the tree in arrays, and by the array loops
+{
+  vector<int> elements = make_elements(n);
+  BinaryTree<int> tree(&elements[0], n);
+  SoABinaryTree<int> soa(&elements[0], n);
+
+  sum = 0;
+  steady_clock::time_point start = steady_clock::now();
+  tree.preorder(add);
+  double t = elapsed(start);
+  long long total = sum;
+  cout << "sum:   BinaryTree preorder      " << t << " ms\n";
+
+  sum = 0;
+  start = steady_clock::now();
+  soa.preorder(add);
+  t = elapsed(start);
+  cout << "sum:   SoABinaryTree preorder   " << t << " ms"
+       << (sum == total ? "\n" : " (DIFFERENT)\n");
+
+  start = steady_clock::now();
+  long long total_reduce =
+    soa.reduce(0LL, [](long long a, long long b) { return a + b; });
+  t = elapsed(start);
+  cout << "sum:   SoABinaryTree reduce     " << t << " ms"
+       << (total_reduce == total ? "\n" : " (DIFFERENT)\n");
+
+  int n_small = 0;
+  start = steady_clock::now();
+  tree.preorder([&n_small](const int& x) { n_small += (x < 1000); });
+  t = elapsed(start);
+  cout << "count: BinaryTree preorder      " << t << " ms\n";
+
+  start = steady_clock::now();
+  int n_small_soa = soa.count_if([](int x) { return x < 1000; });
+  t = elapsed(start);
+  cout << "count: SoABinaryTree count_if   " << t << " ms"
+       << (n_small_soa == n_small ? "\n" : " (DIFFERENT)\n");
+}
+
+/********/
+/* Main */
+/********/
+
+struct Benchmark {
+  const char *name;
+  void (*run)( int n );
+};
+
+static const Benchmark benchmarks[] = {
+  { "alloc", bench_alloc },
+  { "complete", bench_complete },
+  { "traverse", bench_traverse },
+  { "visitor", bench_visitor },
+  { "iterator", bench_iterator },
+  { "morris", bench_morris },
+  { "parallel", bench_parallel },
+  { "augment", bench_augment },
+  { "assign", bench_assign },
+  { "teardown", bench_teardown },
+  { "hash", bench_hash },
+  { "pclone", bench_pclone },
+  { "persistent", bench_persistent },
+  { "intern", bench_intern },
+  { "sparse", bench_sparse },
+  { "mapped", bench_mapped },
+  { "stream", bench_stream },
+  { "rebuild", bench_rebuild },
+  { "search", bench_search },
+  { "avl", bench_avl },
+  { "layout", bench_layout },
+  { "eytzinger", bench_eytzinger },
+  { "kary", bench_kary },
+  { "compact", bench_compact },
+  { "aggregate", bench_aggregate },
+};
+
+int main( int argc, char *argv[] )
+{
+  const char *name = (argc > 1 ? argv[1] : "all");
+  int n = (argc > 2 ? atoi(argv[2]) : 1 << 22);
+
+  for (size_t k = 0; k < sizeof(benchmarks)/sizeof(benchmarks[0]); k++) {
+    if (strcmp(name, "all") == 0 || strcmp(name, benchmarks[k].name) == 0) {
+      cout << "== " << benchmarks[k].name << " (n = " << n << ")\n";
+      benchmarks[k].run(n);
+    }
+  }
+  return 0;
+}
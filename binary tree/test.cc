@@ -1,4 +1,21 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <vector>
+
 #include "BinaryTree.h"
+#include "BinarySearchTree.h"
+#include "AVLTree.h"
+#include "BTFrozenTree.h"
+#include "BTKaryTree.h"
+#include "BTMappedTree.h"
+#include "CompactBinaryTree.h"
+#include "CompleteBinaryTree.h"
+#include "EytzingerTree.h"
+#include "PersistentBinaryTree.h"
+#include "SoABinaryTree.h"
 
 using namespace std;
 
@@ -8,6 +25,45 @@ void func( const int& src )
   cout << src << " ";
 }
 
+static vector<int> visited;
+
+void collect( const int& src )
+  // A test function that records the traversal order in 'visited'
+{
+  visited.push_back(src);
+}
+
+class CountingHeap : public BTNodeHeap<BTNode<int> > {
+  // A heap allocator keeping track of the nodes not yet freed
+ public:
+  int live;
+  CountingHeap() : live(0) {}
+  BTNode<int> *allocate()
+    { live++; return BTNodeHeap<BTNode<int> >::allocate(); }
+  void deallocate( BTNode<int> *node )
+    { live--; BTNodeHeap<BTNode<int> >::deallocate(node); }
+};
+
+class FailingHeap : public BTNodeHeap<BTNode<int> > {
+  // A heap allocator that throws once 'budget' nodes have been taken;
+  // the allocators it spawns share the budget and the count of nodes
+  // not yet freed
+ public:
+  atomic<int> *budget, *live;
+  FailingHeap( atomic<int> *budget, atomic<int> *live )
+    : budget(budget), live(live) {}
+  BTNode<int> *allocate() {
+    if (--*budget < 0)
+      throw bad_alloc();
+    ++*live;
+    return BTNodeHeap<BTNode<int> >::allocate();
+  }
+  void deallocate( BTNode<int> *node )
+    { --*live; BTNodeHeap<BTNode<int> >::deallocate(node); }
+  BTNodeAllocator<BTNode<int> > *spawn() const
+    { return new FailingHeap(budget, live); }
+};
+
 int complete_tree_height( int n )
   // Returns the height of a complete binary tree having 'n' nodes
 {
@@ -77,9 +133,100 @@ int main( int argc, char *argv[] )
      << ", got " << n_leaves << "\n";
   }
 
+  // The parallel versions must agree with the serial ones
+  BTThreadPool pool(4);
+  if (tree.height(pool) != h || tree.node_count(pool, 1) != n_nodes
+      || tree.leaf_count(pool, 0) != n_leaves)
+    cerr << "parallel height()/node_count()/leaf_count() mismatch\n";
+  // An exception from the first task reaches the caller, and leaves no
+  // task of the finished call behind in the pool
+  for (int k = 0; k < 100; k++) {
+    atomic<int> b_runs(0);
+    bool caught = false;
+    try {
+      pool.invoke([]() { throw 1; }, [&b_runs]() { b_runs++; });
+    }
+    catch (int) {
+      caught = true;
+    }
+    if (!caught || b_runs > 1 || tree.node_count(pool, 2) != n_nodes) {
+      cerr << "BTThreadPool: wrong handling of an exception\n";
+      break;
+    }
+  }
+  // An exception from the second task reaches the caller when another
+  // thread steals and runs it: 'a' holds on until 'b' has been stolen
+  for (int k = 0; k < 20; k++) {
+    atomic<bool> b_started(false);
+    bool caught = false;
+    try {
+      pool.invoke([&b_started]() { while (!b_started) this_thread::yield(); },
+                  [&b_started]() { b_started = true; throw 2; });
+    }
+    catch (int e) {
+      caught = (e == 2);
+    }
+    if (!caught || tree.node_count(pool, 2) != n_nodes) {
+      cerr << "BTThreadPool: exception from a stolen task lost\n";
+      break;
+    }
+  }
+
+  // A tree keeping subtree sizes and heights in its nodes
+  BinaryTree<int, BTSubtreeStats> stats_tree(elements, n);
+  BinaryTree<int, BTSubtreeStats> stats_copy(stats_tree);
+  if (stats_copy.height() != h || stats_copy.node_count() != n_nodes
+      || stats_copy.leaf_count() != n_leaves)
+    cerr << "BTSubtreeStats: height/node_count/leaf_count mismatch\n";
+  int k = 0;
+  for (int x : tree) {
+    if (stats_copy.select(k) != x || tree.select(k) != x)
+      cerr << "select(" << k << "): expected " << x << "\n";
+    k++;
+  }
+
+  // Trees keeping Merkle hashes compare by their root hashes
+  BinaryTree<int, BTSubtreeHash> hashed(elements, n), hashed_copy(hashed);
+  if (hashed.hash() != tree.hash() || hashed != hashed_copy
+      || !hashed.equals(hashed_copy, true))
+    cerr << "BTSubtreeHash: expected equal hashes and equal trees\n";
+  hashed_copy.inorder_mutable([n](int& x) { if (x == n) x = 0; });
+  if (n > 0 && (hashed.hash() == hashed_copy.hash() || hashed == hashed_copy
+                || hashed.equals(hashed_copy, true)))
+    cerr << "BTSubtreeHash: modified tree still compares equal\n";
+
   // Use the copy constructor to create a duplicate of 'tree'
   BinaryTree<int> tree_copy(tree);
 
+  // The parallel copy must be identical, augmented data included
+  BinaryTree<int> parallel_copy(tree, pool, 2);
+  BinaryTree<int, BTSubtreeStats> parallel_stats(stats_tree, pool);
+  if (parallel_copy != tree || parallel_stats.node_count() != n_nodes
+      || parallel_stats.height() != h)
+    cerr << "parallel copy constructor: trees differ\n";
+  // A failed allocation in one of the pieces reaches the caller, and
+  // the nodes copied so far are freed
+  {
+    vector<int> many(1024);
+    for (int k = 0; k < 1024; k++)
+      many[k] = k;
+    atomic<int> budget(1023), live(0);
+    FailingHeap failing(&budget, &live);
+    BinaryTree<int> failing_src(&failing);
+    failing_src.init_complete(many.data(), 1023);
+    budget = 600;
+    bool caught = false;
+    try {
+      BinaryTree<int> failed_copy(failing_src, pool, 3);
+    }
+    catch (bad_alloc&) {
+      caught = true;
+    }
+    if (!caught || live != 1023)
+      cerr << "parallel copy constructor: failed copy leaked "
+           << live - 1023 << " nodes\n";
+  }
+
   // Check equality
   if (!(tree_copy == tree)) {
     cerr << "== operator: expected true, got false\n";
@@ -89,8 +236,10 @@ int main( int argc, char *argv[] )
   }
 
 
-  // Empty the copy, and initialize
+  // Empty the copy, and initialize it again: 'init_complete' must build
+  // the same tree from the same elements after 'empty_this'
   tree_copy.empty_this();
+  tree_copy.init_complete(elements, n);
   if (!(tree_copy == tree)) {
     cerr << "== operator: expected true, got false\n";
   }
@@ -102,6 +251,127 @@ int main( int argc, char *argv[] )
     cerr << "== operator: expected true, got false\n";
   }
 
+  // Check a tree whose nodes come from the plain heap instead of
+  // the default per-tree arena
+  BTNodeHeap<BTNode<int> > heap;
+  BinaryTree<int> tree_heap(&heap);
+  tree_heap.init_complete(elements, n);
+  if (tree_heap != tree) {
+    cerr << "heap-allocated tree: expected equal trees\n";
+  }
+
+  // Copy-assign over trees of other shapes, reusing their nodes
+  BinaryTree<int> small_tree(elements, n/2), big_tree(elements, 2*n + 1);
+  small_tree = tree;
+  big_tree = tree;
+  if (small_tree != tree || big_tree != tree
+      || big_tree.node_count() != n_nodes)
+    cerr << "= operator over a different shape: expected equal trees\n";
+
+  // Moving steals the nodes and leaves the source empty
+  BinaryTree<int> moved(std::move(small_tree));
+  big_tree = std::move(moved);
+  if (big_tree != tree || !moved.is_empty() || !small_tree.is_empty())
+    cerr << "move constructor/assignment: wrong result\n";
+  moved = tree;
+  if (moved != tree)
+    cerr << "= operator on a moved-from tree: expected equal trees\n";
+
+  // Every node must be freed again: by copy assignment over a larger
+  // tree, by 'empty_this()' and by the destructor
+  CountingHeap counting;
+  {
+    BinaryTree<int> counted(&counting);
+    counted.init_complete(elements, 2*n + 1);
+    counted = tree;
+    if (counting.live != n)
+      cerr << "= operator: " << counting.live - n << " nodes leaked\n";
+    counted.empty_this();
+    if (counting.live != 0)
+      cerr << "empty_this(): " << counting.live << " nodes leaked\n";
+    counted.init_complete(elements, n);
+  }
+  if (counting.live != 0)
+    cerr << "~BinaryTree(): " << counting.live << " nodes leaked\n";
+  // A parallel copy of a tree sharing the allocator takes its nodes from
+  // it as well, even though 'CountingHeap' does not spawn its own kind
+  {
+    BinaryTree<int> counted(&counting);
+    counted.init_complete(elements, n);
+    BinaryTree<int> counted_copy(counted, pool, 1);
+    if (counting.live != 2 * n || counted_copy != tree)
+      cerr << "parallel copy constructor: nodes not from the allocator\n";
+  }
+  if (counting.live != 0)
+    cerr << "parallel copy constructor: " << counting.live
+         << " nodes leaked\n";
+
+  // Emptying through a reclaimer returns an empty, reusable tree
+  BTReclaimer reclaimer;
+  BinaryTree<int> reclaimed(tree);
+  reclaimed.empty_this(reclaimer);
+  if (!reclaimed.is_empty())
+    cerr << "empty_this(reclaimer): expected an empty tree\n";
+  reclaimed.init_complete(elements, n);
+  reclaimer.drain();
+  if (reclaimed != tree)
+    cerr << "empty_this(reclaimer): tree not reusable\n";
+
+  // A persistent copy shares the nodes until one of the trees changes
+  PersistentBinaryTree<int> version1(elements, n), version2(version1);
+  if (version2.begin().node() != version1.begin().node())
+    cerr << "PersistentBinaryTree: copy does not share its nodes\n";
+  if (!version2.set(n, -1) || version2.set(4*n, 0) || !version2.set(n + 1, 0)
+      || !version2.erase(2))
+    cerr << "PersistentBinaryTree: set()/erase() result mismatch\n";
+  if (version1 != PersistentBinaryTree<int>(elements, n)
+      || version1.node_count() != n_nodes || version2 == version1)
+    cerr << "PersistentBinaryTree: original changed by its copy\n";
+  if (n >= 3 && (version2.at(3) != 3 || version2.contains(2)
+                 || version1.at(n) != n || version1.contains(n + 1)))
+    cerr << "PersistentBinaryTree: wrong elements after set()/erase()\n";
+  int persistent_flat[max_nodes + 1];
+  ostringstream persistent_out, tree_out;
+  persistent_out << version1;
+  tree_out << tree;
+  if (version1.height() != h || version1.leaf_count() != n_leaves
+      || version1.to_flat_array(persistent_flat, n) != n
+      || !equal(persistent_flat + 1, persistent_flat + n + 1, elements + 1)
+      || persistent_out.str() != tree_out.str())
+    cerr << "PersistentBinaryTree: wrong statistics, flat array or output\n";
+
+  // Interned trees share equal subtrees, and equal trees share the root
+  BTInterner<int> interner;
+  int repeated[max_nodes + 1];
+  for (int k = 1; k <= max_nodes; k++)
+    repeated[k] = complete_tree_height(k);  // the same on every level
+  PersistentBinaryTree<int> interned(repeated, n, interner),
+    interned2(repeated, n, interner), plain(repeated, n);
+  if (interned.begin().node() != interned2.begin().node()
+      || interned != interned2 || interned != plain || plain != interned)
+    cerr << "BTInterner: expected shared nodes and equal trees\n";
+  // (a complete tree has at most three different subtrees per level)
+  BTInternStats stats = interner.stats();
+  if (n > 1 && (stats.distinct > 3 * h || stats.dedup_ratio() <= 1))
+    cerr << "BTInterner: " << stats.distinct << " distinct nodes for "
+         << stats.requests << " requests\n";
+  interned2.set(n, 0);
+  if (interned == interned2 || interned2.at(n) != 0
+      || interned2.node_count() != n_nodes)
+    cerr << "BTInterner: set() on an interned tree: wrong result\n";
+  interned2.set(n, repeated[n]);
+  if (interned.begin().node() != interned2.begin().node())
+    cerr << "BTInterner: set() back does not give the same nodes\n";
+  // The paths of the old versions leave the table with them
+  for (int k = 0; k < 100; k++) {
+    interned2.set(n, 1000 + k);
+    interned2.erase(2 * n);
+  }
+  interned2.set(n, repeated[n]);
+  if (interner.stats().distinct != stats.distinct)
+    cerr << "BTInterner: " << interner.stats().distinct - stats.distinct
+         << " nodes of old versions kept\n";
+
   // Check the 'to_flat_array' method
   int elements2[max_nodes + 1];
   tree2.to_flat_array(elements2, n);
@@ -110,6 +380,406 @@ int main( int argc, char *argv[] )
       cerr << "to_flat_array() element mismatch\n";
   }
 
+  // The sparse encoding round-trips any shape, e.g. a deep zigzag path
+  vector<bool> present;
+  vector<int> sparse_elements;
+  if (tree.to_sparse_array(present, sparse_elements) != n_nodes
+      || BinaryTree<int>(present, sparse_elements) != tree
+      || int(present.size()) != 2 * n_nodes + 1)
+    cerr << "to_sparse_array()/init_sparse(): complete tree mismatch\n";
+  int depth = 100;
+  present.assign(1, true);
+  sparse_elements.clear();
+  for (int k = 0; k < depth; k++) {
+    sparse_elements.push_back(k);
+    present.push_back(k + 1 < depth && k % 2 == 0);
+    present.push_back(k + 1 < depth && k % 2 == 1);
+  }
+  BinaryTree<int, BTSubtreeStats> zigzag(present, sparse_elements);
+  vector<bool> present2;
+  vector<int> sparse_elements2;
+  zigzag.to_sparse_array(present2, sparse_elements2);
+  if (zigzag.height() != depth || zigzag.node_count() != depth
+      || present2 != present || sparse_elements2 != sparse_elements)
+    cerr << "to_sparse_array()/init_sparse(): zigzag path mismatch\n";
+  // Comparing and hashing work at any depth, e.g. on a path of a
+  // million nodes
+  int chain_depth = 1000000;
+  vector<bool> chain_present(1, true);
+  vector<int> chain_elements;
+  for (int k = 0; k < chain_depth; k++) {
+    chain_elements.push_back(k);
+    chain_present.push_back(k + 1 < chain_depth);
+    chain_present.push_back(false);
+  }
+  BinaryTree<int> chain(chain_present, chain_elements);
+  BinaryTree<int> chain2(chain_present, chain_elements);
+  if (chain != chain2 || chain.hash() != chain2.hash())
+    cerr << "deep path: == or hash() mismatch\n";
+  chain2.postorder_mutable([chain_depth](int& x) {
+    if (x == chain_depth - 1) x = -1;
+  });
+  if (chain == chain2 || chain.hash() == chain2.hash())
+    cerr << "deep path: changed path still compares equal\n";
+  BinaryTree<int> chain_copy(chain), chain_assigned(tree);
+  chain_assigned = chain;
+  chain2 = chain;
+  if (chain_copy != chain || chain_assigned != chain || chain2 != chain)
+    cerr << "deep path: copy or copy assignment mismatch\n";
+
+  // Compact trees must match the trees they come from in every query,
+  // traversal and conversion, and reuse freed nodes
+  for (int shape = 0; shape < 2; shape++) {
+    BinaryTree<int> source;
+    if (shape == 0)
+      source = tree;
+    else {
+      zigzag.to_sparse_array(present, sparse_elements);
+      source.init_sparse(present, sparse_elements);
+    }
+    CompactBinaryTree<int> compact(source);
+    vector<int> expected_order, compact_order;
+    source.postorder(collect);
+    expected_order.swap(visited);
+    compact.postorder(collect);
+    compact_order.swap(visited);
+    BinaryTree<int> back;
+    compact.to_binary_tree(back);
+    if (compact.height() != source.height()
+        || compact.node_count() != source.node_count()
+        || compact.leaf_count() != source.leaf_count()
+        || compact.hash() != source.hash() || back != source
+        || compact_order != expected_order
+        || !equal(compact.begin(), compact.end(), source.begin())
+        || CompactBinaryTree<int>(compact) != compact)
+      cerr << "CompactBinaryTree: shape " << shape << ": mismatch\n";
+  }
+  CompactBinaryTree<int> compact(elements, n);
+  vector<int> compact_flat(n + 1);
+  if (sizeof(BTCompactNode<int>) != 12
+      || compact.to_flat_array(compact_flat.data(), n) != n
+      || !equal(compact_flat.begin() + 1, compact_flat.end(), elements + 1))
+    cerr << "CompactBinaryTree: wrong node size or flat array\n";
+  size_t compact_bytes = compact.bytes_reserved();
+  CompactBinaryTree<int>::Handle top = compact.root_node();
+  CompactBinaryTree<int>::Handle cut = compact.left(top);
+  compact.set_left(top, 0);
+  compact.delete_subtree(cut);
+  int cut_size = n - compact.node_count();
+  for (int k = 0; k < cut_size; k++)
+    compact.set_left(top, compact.new_node(k, compact.left(top)));
+  if (compact.bytes_reserved() != compact_bytes
+      || compact.node_count() != n || compact.height() < cut_size + 1)
+    cerr << "CompactBinaryTree: freed nodes not reused\n";
+  // a moved-from tree is empty and can be built on again
+  CompactBinaryTree<int> compact_moved(std::move(compact));
+  compact.set_root(compact.new_node(7));
+  if (compact_moved.node_count() != n || compact.node_count() != 1
+      || compact.root_node() != 1 || compact.elem(1) != 7)
+    cerr << "CompactBinaryTree: wrong moved-from tree\n";
+
+  // Trees in arrays must match the trees they come from, and their
+  // aggregates must match those of a traversal
+  for (int shape = 0; shape < 2; shape++) {
+    SoABinaryTree<int> soa;
+    if (shape == 0)
+      soa.init_complete(elements, n);
+    else {
+      zigzag.to_sparse_array(present, sparse_elements);
+      soa.init_sparse(present, sparse_elements);
+    }
+    BinaryTree<int> source;
+    soa.to_binary_tree(source);
+    vector<int> expected_order, soa_order;
+    source.inorder(collect);
+    expected_order.swap(visited);
+    soa.inorder(collect);
+    soa_order.swap(visited);
+    long long total = 0;
+    int n_odd = 0, smallest = INT32_MAX;
+    source.preorder([&](const int& x) {
+      total += x; n_odd += x % 2; smallest = min(smallest, x); });
+    if (soa.height() != source.height()
+        || soa.node_count() != source.node_count()
+        || soa.leaf_count() != source.leaf_count()
+        || soa.hash() != source.hash() || soa_order != expected_order
+        || SoABinaryTree<int>(source) != soa
+        || soa.reduce(0LL, [](long long a, long long b) { return a + b; })
+           != total
+        || soa.reduce(INT32_MAX, [](int a, int b) { return min(a, b); })
+           != smallest
+        || soa.count_if([](int x) { return x % 2 != 0; }) != n_odd)
+      cerr << "SoABinaryTree: shape " << shape << ": mismatch\n";
+  }
+
+  // A tree saved to a file is viewed in place, complete or not
+  BTMappedTree<int> mapped;
+  if (!BTMappedTree<int>::write(tree, "tree.bt") || !mapped.open("tree.bt")
+      || !mapped.is_complete() || mapped.height() != h
+      || mapped.node_count() != n_nodes || mapped.leaf_count() != n_leaves)
+    cerr << "BTMappedTree: complete tree: wrong file or statistics\n";
+  for (int order = 0; order < 3; order++) {
+    vector<int> expected_order;
+    visited.clear();
+    if (order == 0) {
+      tree.preorder(collect);
+      expected_order.swap(visited);
+      mapped.preorder(collect);
+    } else if (order == 1) {
+      tree.inorder(collect);
+      expected_order.swap(visited);
+      mapped.inorder(collect);
+    } else {
+      tree.postorder(collect);
+      expected_order.swap(visited);
+      mapped.postorder(collect);
+    }
+    if (visited != expected_order)
+      cerr << "BTMappedTree: traversal " << order << " mismatch\n";
+  }
+  if (!BTMappedTree<int>::write(zigzag, "tree.bt") || !mapped.open("tree.bt")
+      || mapped.is_complete() || mapped.height() != depth
+      || mapped.leaf_count() != 1)
+    cerr << "BTMappedTree: zigzag path: wrong file or statistics\n";
+  visited.clear();
+  mapped.inorder(collect);
+  vector<int> zigzag_inorder(zigzag.begin(), zigzag.end());
+  if (visited != zigzag_inorder || BTMappedTree<double>().open("tree.bt"))
+    cerr << "BTMappedTree: zigzag path: inorder or type check mismatch\n";
+  mapped.close();
+  // a link out of the tree, or back up it, must be rejected
+  string tree_file;
+  {
+    ifstream in("tree.bt", ios::binary);
+    tree_file.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  }
+  int32_t bad_links[] = { 1 << 20, 0 };
+  for (int k = 0; k < 2; k++) {
+    memcpy(&tree_file[tree_file.size() - 4], &bad_links[k], 4);
+    ofstream("tree.bt", ios::binary | ios::trunc) << tree_file;
+    if (mapped.open("tree.bt"))
+      cerr << "BTMappedTree: corrupt link " << bad_links[k] << " accepted\n";
+  }
+  // so must a node that no link reaches: cut the last node off its parent
+  // (the links of the last two nodes end the file)
+  int32_t no_links[] = { -1, -1, -1, -1 };
+  memcpy(&tree_file[tree_file.size() - 16], no_links, 16);
+  ofstream("tree.bt", ios::binary | ios::trunc) << tree_file;
+  if (mapped.open("tree.bt"))
+    cerr << "BTMappedTree: orphan node accepted\n";
+  remove("tree.bt");
+
+  // Binary streams read back in small chunks, records straddling them
+  for (int size = 0; size <= n; size++) {
+    BinaryTree<int> sized(elements, size), streamed;
+    stringstream complete_stream, preorder_stream;
+    sized.write_complete(complete_stream);
+    sized.write_preorder(preorder_stream);
+    if (!streamed.read_complete(complete_stream, 7) || streamed != sized)
+      cerr << "read_complete(): mismatch for " << size << " nodes\n";
+    if (!streamed.read_preorder(preorder_stream, 3) || streamed != sized)
+      cerr << "read_preorder(): mismatch for " << size << " nodes\n";
+  }
+  stringstream zigzag_stream;
+  zigzag.write_preorder(zigzag_stream);
+  BinaryTree<int, BTSubtreeStats> zigzag2;
+  if (!zigzag2.read_preorder(zigzag_stream, 5) || zigzag2 != zigzag
+      || zigzag2.height() != depth)
+    cerr << "read_preorder(): zigzag path mismatch\n";
+  string truncated = zigzag_stream.str();
+  truncated.resize(truncated.size() - 2);
+  zigzag_stream.str(truncated);
+  zigzag_stream.clear();
+  if (zigzag2.read_preorder(zigzag_stream))
+    cerr << "read_preorder(): truncated stream not detected\n";
+  // a flag byte alone is not a tree, and the data after a tree is left
+  // in the stream
+  stringstream flag_only(string(1, '\0'));
+  if (zigzag2.read_preorder(flag_only))
+    cerr << "read_preorder(): lone flag byte not detected\n";
+  stringstream followed;
+  zigzag.write_preorder(followed);
+  followed << "tail";
+  string tail;
+  if (!zigzag2.read_preorder(followed, 64) || !(followed >> tail)
+      || tail != "tail")
+    cerr << "read_preorder(): data after the tree consumed\n";
+
+  // Trees of any shape are rebuilt from two of their traversals
+  for (int shape = 0; shape < 3; shape++) {
+    BinaryTree<int, BTSubtreeStats> source;
+    if (shape == 0)
+      source.init_complete(elements, n);
+    else if (shape == 1)
+      source = zigzag;
+    else
+      source.init_sparse(vector<bool>{ 1, 1, 1, 0, 1, 1, 0, 0, 0, 0, 0 },
+                         vector<int>{ 1, 2, 3, 4, 5 });
+    vector<int> pre, in, post;
+    source.preorder([&pre](const int& x) { pre.push_back(x); });
+    source.inorder([&in](const int& x) { in.push_back(x); });
+    source.postorder([&post](const int& x) { post.push_back(x); });
+    BinaryTree<int, BTSubtreeStats> rebuilt, rebuilt2;
+    if (!rebuilt.init_preorder_inorder(pre, in) || rebuilt != source
+        || !rebuilt2.init_postorder_inorder(post, in) || rebuilt2 != source
+        || rebuilt2.height() != source.height())
+      cerr << "init_preorder_inorder()/init_postorder_inorder(): shape "
+           << shape << " mismatch\n";
+    if (!in.empty()) {
+      in.back() = -1;
+      if (rebuilt.init_preorder_inorder(pre, in) || !rebuilt.is_empty())
+        cerr << "init_preorder_inorder(): inconsistent sequences accepted\n";
+    }
+  }
+
+  // A search tree must agree with 'std::set' through inserts and erases
+  BinarySearchTree<int, less<int>, BTSubtreeStats> bst;
+  set<int> reference;
+  unsigned state = 1;
+  for (int k = 0; k < 20 * max_nodes; k++) {
+    state = state * 1103515245 + 12345;
+    int x = int(state >> 16) % (2 * max_nodes);
+    bool inserted = (k % 3 != 2);
+    if (inserted ? bst.insert(x) != reference.insert(x).second
+                 : bst.erase(x) != (reference.erase(x) == 1))
+      cerr << "BinarySearchTree: insert()/erase() result mismatch\n";
+  }
+  if (bst.node_count() != int(reference.size())
+      || !equal(reference.begin(), reference.end(), bst.begin()))
+    cerr << "BinarySearchTree: contents differ from std::set\n";
+  for (int x = -1; x <= 2 * max_nodes; x++) {
+    set<int>::iterator bound = reference.lower_bound(x);
+    const int *found = bst.lower_bound(x);
+    if ((bound == reference.end() ? found != NULL : !found || *found != *bound)
+        || bst.contains(x) != (reference.count(x) == 1))
+      cerr << "BinarySearchTree: lower_bound()/find() mismatch at " << x
+           << "\n";
+  }
+  if (!reference.empty() && bst.select(int(reference.size()) / 2)
+      != *next(reference.begin(), reference.size() / 2))
+    cerr << "BinarySearchTree: select() mismatch after erase()\n";
+  vector<int> sorted(reference.begin(), reference.end());
+  BinarySearchTree<int> balanced(sorted.data(), int(sorted.size()));
+  if (balanced.height() != complete_tree_height(int(sorted.size()))
+      || !equal(sorted.begin(), sorted.end(), balanced.begin()))
+    cerr << "BinarySearchTree: init_sorted() not balanced or not sorted\n";
+
+  // An AVL tree stays balanced under sorted insertions and erasures
+  AVLTree<int> avl;
+  for (int k = 0; k < max_nodes; k++)
+    avl.insert(k);
+  for (int k = 0; k < max_nodes; k += 3)
+    avl.erase(k);
+  bool avl_balanced = true;
+  for (AVLTree<int>::preorder_iterator it = avl.preorder_begin();
+       it != avl.preorder_end(); ++it) {
+    const AVLTree<int>::Node *node = it.node();
+    int lh = BTSubtreeStats::cached_height(node->left);
+    int rh = BTSubtreeStats::cached_height(node->right);
+    if (lh - rh > 1 || rh - lh > 1 || node->subtree_height != 1 + max(lh, rh))
+      avl_balanced = false;
+  }
+  if (!avl_balanced || avl.node_count() != max_nodes - (max_nodes + 2) / 3
+      || avl.height() > complete_tree_height(max_nodes) * 3 / 2
+      || avl.contains(3) || !avl.contains(4))
+    cerr << "AVLTree: unbalanced or wrong contents\n";
+
+  // Frozen copies answer the searches like the trees they come from
+  for (int layout = BTLayoutBFS; layout <= BTLayoutVEB; layout++) {
+    BTFrozenTree<int> frozen_bst(bst, BTLayout(layout));
+    BTFrozenTree<int> frozen_avl(avl, BTLayout(layout));
+    vector<int> frozen_inorder;
+    frozen_bst.inorder([&](const int& x) { frozen_inorder.push_back(x); });
+    if (frozen_bst.node_count() != bst.node_count()
+        || frozen_bst.height() != bst.height()
+        || !equal(frozen_inorder.begin(), frozen_inorder.end(), bst.begin())
+        || frozen_inorder.size() != reference.size())
+      cerr << "BTFrozenTree: layout " << layout << ": wrong contents\n";
+    for (int x = -1; x <= 2 * max_nodes; x++) {
+      const int *bound = bst.lower_bound(x), *frozen = frozen_bst.lower_bound(x);
+      if ((bound ? !frozen || *frozen != *bound : frozen != NULL)
+          || frozen_avl.contains(x) != avl.contains(x))
+        cerr << "BTFrozenTree: layout " << layout << ": search mismatch at "
+             << x << "\n";
+    }
+  }
+
+  // Eytzinger searches must agree with 'std::lower_bound', one by one
+  // and in batches, for every size up to 'max_nodes'
+  vector<int> evens(max_nodes), queries2, batch(2 * max_nodes + 2);
+  for (int k = 0; k < max_nodes; k++)
+    evens[k] = 2 * k;
+  for (int x = -1; x <= 2 * max_nodes; x++)
+    queries2.push_back(x);
+  for (int size = 0; size <= max_nodes; size++) {
+    EytzingerTree<int> eytzinger(evens.data(), size);
+    if (eytzinger != EytzingerTree<int>(evens.data(), size)
+        || eytzinger.node_count() != size)
+      cerr << "EytzingerTree: size " << size << ": == operator mismatch\n";
+    eytzinger.lower_bound_batch(queries2.data(), int(queries2.size()),
+                                batch.data());
+    for (size_t q = 0; q < queries2.size(); q++) {
+      int x = queries2[q];
+      vector<int>::iterator bound =
+        std::lower_bound(evens.begin(), evens.begin() + size, x);
+      const int *found = eytzinger.lower_bound(x);
+      bool ok = (bound == evens.begin() + size
+                 ? !found && batch[q] == 0
+                 : found && *found == *bound && eytzinger[batch[q]] == *bound);
+      if (!ok || eytzinger.contains(x) != (x >= 0 && x % 2 == 0
+                                           && x < 2 * size)) {
+        cerr << "EytzingerTree: size " << size << ": mismatch at " << x
+             << "\n";
+        break;
+      }
+    }
+  }
+
+  // K-ary searches must agree with 'std::lower_bound' at every SIMD
+  // level, for signed keys and for unsigned keys across the sign bit
+  int kary_sizes[] = { 0, 1, 15, 16, 17, 272, 289, 1000 };
+  for (int level = BTSimdScalar; level <= BTSimdAVX2; level++) {
+    for (int s = 0; s < int(sizeof(kary_sizes) / sizeof(kary_sizes[0])); s++) {
+      int size = kary_sizes[s];
+      vector<int> keys(size);
+      vector<uint32_t> ukeys(size);
+      for (int k = 0; k < size; k++) {
+        keys[k] = 2 * k - size;
+        ukeys[k] = 0x80000000u - uint32_t(size) + 2 * uint32_t(k);
+      }
+      BinarySearchTree<int> source(keys.data(), size);
+      BTKaryTree<int> kary(source);
+      BTKaryTree<uint32_t> ukary(ukeys.data(), size);
+      kary.set_simd(BTSimdLevel(level));
+      ukary.set_simd(BTSimdLevel(level));
+      bool ok = kary.node_count() == size;
+      for (int x = -size - 2; x <= size + 2 && ok; x++) {
+        vector<int>::iterator bound =
+          std::lower_bound(keys.begin(), keys.end(), x);
+        uint32_t ux = 0x80000000u + uint32_t(x);
+        vector<uint32_t>::iterator ubound =
+          std::lower_bound(ukeys.begin(), ukeys.end(), ux);
+        int found;
+        uint32_t ufound;
+        ok = (bound == keys.end() ? !kary.lower_bound(x, found)
+              : kary.lower_bound(x, found) && found == *bound)
+          && (ubound == ukeys.end() ? !ukary.lower_bound(ux, ufound)
+              : ukary.lower_bound(ux, ufound) && ufound == *ubound)
+          && kary.contains(x) == binary_search(keys.begin(), keys.end(), x)
+          && ukary.contains(ux) == binary_search(ukeys.begin(), ukeys.end(), ux);
+      }
+      if (!ok)
+        cerr << "BTKaryTree: level " << level << ", size " << size
+             << ": mismatch\n";
+    }
+  }
+  int extremes[] = { INT32_MIN, 0, INT32_MAX };
+  BTKaryTree<int> kary_extremes(extremes, 3);
+  int found;
+  if (!kary_extremes.contains(INT32_MAX) || !kary_extremes.contains(INT32_MIN)
+      || !kary_extremes.lower_bound(1, found) || found != INT32_MAX)
+    cerr << "BTKaryTree: wrong result for extreme keys\n";
+
   // Check the traversals
   cout << "Preorder traversal:\n";
   tree.preorder(func);
@@ -123,6 +793,93 @@ int main( int argc, char *argv[] )
   tree.postorder(func);
   cout << "\n";
 
+  // Traversals sharing one stack buffer must match fresh ones
+  BinaryTree<int>::TraversalStack stack;
+  visited.clear();
+  tree.preorder(collect, stack);
+  tree.inorder(collect, stack);
+  tree.postorder(collect, stack);
+  vector<int> with_stack;
+  with_stack.swap(visited);
+  tree.preorder(collect);
+  tree.inorder(collect);
+  tree.postorder(collect);
+  if (visited != with_stack)
+    cerr << "traversal with a reused stack: order mismatch\n";
+
+  // Traversals with a stateful callable, and with mutable elements
+  long sum = 0;
+  tree.inorder([&sum](const int& x) { sum += x; });
+  if (sum != n*(n + 1)/2)
+    cerr << "inorder() with a lambda: wrong sum " << sum << "\n";
+  tree2.postorder_mutable([](int& x) { x *= 2; });
+  sum = 0;
+  tree2.preorder([&sum](const int& x) { sum += x; });
+  if (sum != n*(n + 1))
+    cerr << "postorder_mutable(): wrong sum " << sum << "\n";
+
+  // The Morris traversals must match, and leave the tree unchanged
+  vector<int> morris;
+  tree2.morris_preorder([&morris](const int& x) { morris.push_back(x); });
+  tree2.morris_inorder([&morris](const int& x) { morris.push_back(x); });
+  vector<int> expected_morris;
+  tree2.preorder([&](const int& x) { expected_morris.push_back(x); });
+  tree2.inorder([&](const int& x) { expected_morris.push_back(x); });
+  if (morris != expected_morris)
+    cerr << "morris_preorder()/morris_inorder(): order mismatch\n";
+  if (tree2.node_count() != n || tree2.leaf_count() != n_leaves)
+    cerr << "Morris traversal left the tree modified\n";
+
+  // The iterators must produce the same orders as the traversals
+  vector<int> by_iterator;
+  for (BinaryTree<int>::preorder_iterator it = tree.preorder_begin();
+       it != tree.preorder_end(); ++it)
+    by_iterator.push_back(*it);
+  for (int x : tree)
+    by_iterator.push_back(x);
+  for (BinaryTree<int>::postorder_iterator it = tree.postorder_begin();
+       it != tree.postorder_end(); it++)
+    by_iterator.push_back(*it);
+  if (by_iterator != visited)
+    cerr << "iterators: order mismatch with the traversals\n";
+  by_iterator.assign(tree.levelorder_begin(), tree.levelorder_end());
+  if (by_iterator != vector<int>(elements + 1, elements + n + 1))
+    cerr << "levelorder iterator: expected complete-tree order\n";
+  if (find_if(tree.begin(), tree.end(), [n](int x) { return x == n; })
+      == tree.end()
+      || find(tree.begin(), tree.end(), n + 1) != tree.end())
+    cerr << "find() over the inorder iterator: wrong result\n";
+
+  // Check the array-based complete tree against the linked one
+  CompleteBinaryTree<int> ctree(elements, n);
+  if (ctree.height() != h || ctree.node_count() != n_nodes
+      || ctree.leaf_count() != n_leaves) {
+    cerr << "CompleteBinaryTree: height/node_count/leaf_count mismatch\n";
+  }
+  int elements3[max_nodes + 1];
+  if (ctree.to_flat_array(elements3, n) != n)
+    cerr << "CompleteBinaryTree: to_flat_array() count mismatch\n";
+  for (int k = 1; k <= n; k++) {
+    if (elements3[k] != elements[k])
+      cerr << "CompleteBinaryTree: to_flat_array() element mismatch\n";
+  }
+  vector<int> expected;
+  visited.clear();
+  tree.postorder(collect);
+  expected.swap(visited);
+  ctree.postorder(collect);
+  if (visited != expected)
+    cerr << "CompleteBinaryTree: postorder() mismatch\n";
+  if (!(ctree == CompleteBinaryTree<int>(elements, n)))
+    cerr << "CompleteBinaryTree: == operator: expected true, got false\n";
+  // the unused cell 0 of the array must not matter
+  int elements4[max_nodes + 1];
+  copy(elements, elements + n + 1, elements4);
+  elements4[0] = -1;
+  if (!(ctree == CompleteBinaryTree<int>(elements4, n))
+      || !(CompleteBinaryTree<int>() == CompleteBinaryTree<int>(elements4, 0)))
+    cerr << "CompleteBinaryTree: == operator: cell 0 compared\n";
+
   // Finish the PDF object
   pdf->finish();
   delete pdf;